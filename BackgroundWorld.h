@@ -0,0 +1,184 @@
+#ifndef BACKGROUNDWORLD_H
+#define BACKGROUNDWORLD_H
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "World.h"
+
+// generates worlds on a background thread while the last finished one is
+// shown; there are two buffers, the current one, which only the caller
+// reads, and the next one, which only the background thread writes.
+// Requests made while a generation runs replace each other, so only the
+// latest one is generated after it. With a preview step, every request is
+// first generated as a preview at that fraction of the resolution and
+// then refined to the full world, unless a newer request came in first
+class BackgroundWorld
+{
+private:
+    struct Buffer
+    {
+        World world, preview;
+        std::unique_ptr<PerlinNoise2D> noise;
+        GenerationStats stats;
+        Erosion erosion;
+        WorldSettings settings;
+        bool showsPreview = false;
+
+        Buffer(unsigned width, unsigned height, unsigned previewStep) :
+            world(width, height), preview(width, height, previewStep) {}
+    };
+
+    Buffer buffers[2];
+    unsigned current = 0;
+    ThreadPool *pool;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    WorldSettings pending;
+    bool hasPending = false, pendingPreview = false;
+    bool previews;
+    // the next buffer is finished and waits for swap()
+    bool ready = false;
+    bool busy = false;
+    bool stopping = false;
+    std::thread worker;
+
+    void generate(Buffer &buffer, const WorldSettings &settings, bool preview)
+    {
+        // a new noise only for a new seed or hash, so the world can reuse
+        // its cached fields for everything else
+        if(!buffer.noise || buffer.noise->getSeed() != settings.seed ||
+           buffer.noise->getHash() != settings.hash)
+            buffer.noise.reset(new PerlinNoise2D(settings.octaves, settings.seed, settings.hash));
+        else
+            buffer.noise->setOctaves(settings.octaves);
+        World &world = preview ? buffer.preview : buffer.world;
+        world.noise = buffer.noise.get();
+        world.pool = pool;
+        world.a = settings.a;
+        world.b = settings.b;
+        world.c = settings.c;
+        world.warp = settings.warp;
+        world.maxRivers = settings.maxRivers;
+        world.biomes = settings.biomes;
+        world.terrain = settings.terrain;
+        world.stats = settings.stats ? &buffer.stats : nullptr;
+        world.erosion = settings.erode ? &buffer.erosion : nullptr;
+        world.generate(settings.adjust);
+        buffer.settings = settings;
+        buffer.showsPreview = preview;
+    }
+
+    void loop()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while(true)
+        {
+            // the next buffer may only be written once the finished world
+            // in it was swapped in
+            wake.wait(lock, [&]() { return stopping || (hasPending && !ready); });
+            if(stopping)
+                return;
+            WorldSettings settings = pending;
+            bool preview = pendingPreview;
+            Buffer &buffer = buffers[1 - current];
+            hasPending = false;
+            busy = true;
+            lock.unlock();
+            generate(buffer, settings, preview);
+            lock.lock();
+            busy = false;
+            ready = true;
+            // refine the preview unless it is already stale
+            if(preview && !hasPending)
+            {
+                hasPending = true;
+                pendingPreview = false;
+            }
+        }
+    }
+public:
+    // pool is used by the background thread only; previewStep 1 turns
+    // the previews off
+    BackgroundWorld(unsigned width, unsigned height, ThreadPool *_pool = nullptr,
+                    unsigned previewStep = 4) :
+        buffers{Buffer(width, height, previewStep), Buffer(width, height, previewStep)},
+        pool(_pool), previews(previewStep > 1)
+    {
+        worker = std::thread(&BackgroundWorld::loop, this);
+    }
+
+    ~BackgroundWorld()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        worker.join();
+    }
+
+    // generates a world with settings after the running generation,
+    // replacing any request that has not started yet
+    void request(const WorldSettings &settings)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending = settings;
+            hasPending = true;
+            pendingPreview = previews;
+        }
+        wake.notify_all();
+    }
+
+    // makes the newest finished world current; call between frames.
+    // Returns whether the current world changed
+    bool swap()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(!ready)
+                return false;
+            current = 1 - current;
+            ready = false;
+        }
+        wake.notify_all();
+        return true;
+    }
+
+    // whether a generation is running or waiting to run
+    bool isBusy()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return busy || hasPending || ready;
+    }
+
+    // the current world, all ocean before the first swap(); see
+    // World::getStep() for its resolution
+    const World &getWorld() const
+    {
+        const Buffer &buffer = buffers[current];
+        return buffer.showsPreview ? buffer.preview : buffer.world;
+    }
+
+    // whether the current world is a preview that is still being refined
+    bool isPreview() const
+    {
+        return buffers[current].showsPreview;
+    }
+
+    const WorldSettings &getSettings() const
+    {
+        return buffers[current].settings;
+    }
+
+    // stats of the current world when its settings asked for them
+    const GenerationStats &getStats() const
+    {
+        return buffers[current].stats;
+    }
+};
+
+#endif // BACKGROUNDWORLD_H
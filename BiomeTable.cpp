@@ -0,0 +1,226 @@
+#include "BiomeTable.h"
+#include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+const unsigned BiomeTable::MAX_THRESHOLDS = 16;
+
+// moisture < -0.4 used to be compared as a double; -0.4f is the largest
+// float below -0.4, so that is moisture above -0.4 as a float
+const char *const BiomeTable::DEFAULT_RULES =
+    "height from -1 ocean\n"
+    "height from -0.1 coast\n"
+    "height from 0 beach\n"
+    "moisture above -0.1 grassland\n"
+    "height from 0.02 steppe\n"
+    "moisture above -0.4 grassland\n"
+    "height from 0.2 grassland\n"
+    "moisture above 0 forest\n"
+    "height from 0.3 forest\n"
+    "height from 0.4 mountains\n"
+    "height from 0.5 mountains\n"
+    "moisture from 0.1 snow\n";
+
+namespace
+{
+    // tiles a kernel indexes at a time
+    const unsigned CHUNK = 256;
+
+    typedef void (*Kernel)(const float *heightThresholds, const float *moistureThresholds,
+                           uint32_t columns, const World::BIOME *biomes, const float *heights,
+                           const float *moistures, World::BIOME *out, unsigned count);
+
+    // the interval of a value is the number of thresholds it reaches; the
+    // thresholds past the real ones are NaN, which nothing reaches, so the
+    // loops over them have a fixed length that is unrolled and the loop
+    // over the tiles vectorizes
+    template<unsigned HEIGHTS, unsigned MOISTURES>
+    void classifyTiles(const float *heightThresholds, const float *moistureThresholds,
+                       uint32_t columns, const World::BIOME *biomes, const float *heights,
+                       const float *moistures, World::BIOME *out, unsigned count)
+    {
+        float heightLevels[HEIGHTS], moistureLevels[MOISTURES];
+        std::copy(heightThresholds, heightThresholds + HEIGHTS, heightLevels);
+        std::copy(moistureThresholds, moistureThresholds + MOISTURES, moistureLevels);
+        uint32_t cells[CHUNK];
+        for(unsigned start = 0; start < count; start += CHUNK)
+        {
+            unsigned n = std::min(CHUNK, count - start);
+            const float *height = heights + start, *moisture = moistures + start;
+            for(unsigned i = 0; i < n; ++i)
+            {
+                uint32_t row = 0, column = 0;
+                for(unsigned t = 0; t < HEIGHTS; ++t)
+                    row += height[i] >= heightLevels[t];
+                for(unsigned t = 0; t < MOISTURES; ++t)
+                    column += moisture[i] >= moistureLevels[t];
+                cells[i] = row * columns + column;
+            }
+            for(unsigned i = 0; i < n; ++i)
+                out[start + i] = biomes[cells[i]];
+        }
+    }
+
+    // the kernel for capacity 4 << i
+    template<unsigned HEIGHTS>
+    Kernel selectMoistures(unsigned i)
+    {
+        return i == 0 ? classifyTiles<HEIGHTS, 4> :
+               i == 1 ? classifyTiles<HEIGHTS, 8> : classifyTiles<HEIGHTS, 16>;
+    }
+
+    Kernel selectKernel(unsigned heights, unsigned moistures)
+    {
+        return heights == 0 ? selectMoistures<4>(moistures) :
+               heights == 1 ? selectMoistures<8>(moistures) : selectMoistures<16>(moistures);
+    }
+
+    // 4, 8 or 16
+    unsigned capacity(unsigned thresholds)
+    {
+        return thresholds <= 4 ? 4 : thresholds <= 8 ? 8 : 16;
+    }
+
+    struct Range
+    {
+        float from;
+        World::BIOME biome;
+    };
+
+    // ranges[0] starts below every moisture
+    struct Band
+    {
+        float from;
+        std::vector<Range> ranges;
+    };
+
+    // the smallest value that reaches the threshold of "from X" or
+    // "above X" in line
+    bool readThreshold(std::istream &line, float &value)
+    {
+        std::string kind, number;
+        if(!(line >> kind >> number) || (kind != "from" && kind != "above"))
+            return false;
+        char *end;
+        value = strtof(number.c_str(), &end);
+        if(end == number.c_str() || *end || isnan(value))
+            return false;
+        if(kind == "above")
+            value = nextafterf(value, INFINITY);
+        return true;
+    }
+
+    bool readBiome(std::istream &line, World::BIOME &biome)
+    {
+        std::string name;
+        if(!(line >> name))
+            return false;
+        for(unsigned b = 0; b < World::RIVER; ++b)
+            if(name == World::BIOME_NAMES[b])
+            {
+                biome = (World::BIOME) b;
+                return true;
+            }
+        return false;
+    }
+}
+
+BiomeTable::BiomeTable()
+{
+    parse(DEFAULT_RULES);
+}
+
+bool BiomeTable::parse(const std::string &text)
+{
+    std::vector<Band> bands;
+    std::istringstream input(text);
+    std::string row;
+    while(std::getline(input, row))
+    {
+        std::istringstream line(row.substr(0, row.find('#')));
+        std::string kind, rest;
+        float from;
+        World::BIOME biome;
+        if(!(line >> kind))
+            continue;
+        if(!readThreshold(line, from) || !readBiome(line, biome) || line >> rest)
+            return false;
+        Range range = {from, biome};
+        if(kind == "height")
+        {
+            if(!bands.empty() && from <= bands.back().from)
+                return false;
+            range.from = -INFINITY;
+            Band band = {from, std::vector<Range>(1, range)};
+            bands.push_back(band);
+        }
+        else if(kind == "moisture")
+        {
+            if(bands.empty() || from <= bands.back().ranges.back().from)
+                return false;
+            bands.back().ranges.push_back(range);
+        }
+        else
+            return false;
+    }
+    if(bands.empty())
+        return false;
+
+    std::vector<float> heights, moistures;
+    for(unsigned h = 1; h < bands.size(); ++h)
+        heights.push_back(bands[h].from);
+    for(auto &band : bands)
+        for(unsigned r = 1; r < band.ranges.size(); ++r)
+            moistures.push_back(band.ranges[r].from);
+    std::sort(moistures.begin(), moistures.end());
+    moistures.erase(std::unique(moistures.begin(), moistures.end()), moistures.end());
+    if(heights.size() > MAX_THRESHOLDS || moistures.size() > MAX_THRESHOLDS)
+        return false;
+    // every band splits at the moistures of all bands, and an interval
+    // gets the biome of the range it lies in
+    unsigned intervals = moistures.size() + 1;
+    std::vector<World::BIOME> table((size_t) bands.size() * intervals);
+    for(unsigned h = 0; h < bands.size(); ++h)
+    {
+        const std::vector<Range> &ranges = bands[h].ranges;
+        unsigned r = 0;
+        for(unsigned m = 0; m < intervals; ++m)
+        {
+            while(m > 0 && r + 1 < ranges.size() && ranges[r + 1].from <= moistures[m - 1])
+                ++r;
+            table[(size_t) h * intervals + m] = ranges[r].biome;
+        }
+    }
+    columns = intervals;
+    heights.resize(capacity(heights.size()), NAN);
+    moistures.resize(capacity(moistures.size()), NAN);
+    heightThresholds.swap(heights);
+    moistureThresholds.swap(moistures);
+    biomes.swap(table);
+    return true;
+}
+
+bool BiomeTable::load(const std::string &path)
+{
+    std::ifstream file(path.c_str());
+    std::stringstream text;
+    text << file.rdbuf();
+    return file && parse(text.str());
+}
+
+void BiomeTable::classify(const float *heights, const float *moistures, World::BIOME *out,
+                          unsigned count) const
+{
+    Kernel kernel = selectKernel(heightThresholds.size() / 8, moistureThresholds.size() / 8);
+    kernel(heightThresholds.data(), moistureThresholds.data(), columns, biomes.data(), heights,
+           moistures, out, count);
+}
+
+const BiomeTable &BiomeTable::getDefault()
+{
+    // built on first use, which is thread safe
+    static const BiomeTable table;
+    return table;
+}
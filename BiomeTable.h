@@ -0,0 +1,63 @@
+#ifndef BIOMETABLE_H
+#define BIOMETABLE_H
+
+#include <string>
+#include <vector>
+#include "World.h"
+
+// biome rules by height and moisture, compiled into a table: the
+// thresholds split heights and moistures into intervals, and the biome
+// of a tile is the table entry of its two intervals. Rules are text, one
+// per line, a '#' starts a comment:
+//
+//   height from|above H BIOME     a band of BIOME from height H up
+//   moisture from|above M BIOME   BIOME from moisture M up in that band
+//
+// "from" includes the value and "above" does not. Heights increase from
+// band to band and moistures within a band; the lowest band also takes
+// the heights below it, and the first biome of a band the moistures below
+// its first moisture rule. There are at most MAX_THRESHOLDS different
+// heights and moistures; coast is turned into ocean near other ocean by
+// World, river is not allowed
+class BiomeTable
+{
+public:
+    // the rules of the World biomes; they assign every height and
+    // moisture the biome the former hard coded comparisons did
+    static const char *const DEFAULT_RULES;
+    static const unsigned MAX_THRESHOLDS;
+
+    // the default rules
+    BiomeTable();
+
+    // replaces the rules with those of text, false and unchanged when
+    // text has an error
+    bool parse(const std::string &text);
+
+    // parse() of the contents of the file at path
+    bool load(const std::string &path);
+
+    // out[i] is the biome of heights[i] and moistures[i] for i below count
+    void classify(const float *heights, const float *moistures, World::BIOME *out,
+                  unsigned count) const;
+
+    World::BIOME getBiome(float height, float moisture) const
+    {
+        World::BIOME biome;
+        classify(&height, &moisture, &biome, 1);
+        return biome;
+    }
+
+    // one shared table of the default rules
+    static const BiomeTable &getDefault();
+private:
+    // smallest height and moisture of every interval but the first,
+    // padded with NaN to 4, 8 or 16
+    std::vector<float> heightThresholds, moistureThresholds;
+    // moisture intervals; the biome of height interval h and moisture
+    // interval m is at h * columns + m
+    unsigned columns = 1;
+    std::vector<World::BIOME> biomes;
+};
+
+#endif // BIOMETABLE_H
@@ -0,0 +1,194 @@
+#ifndef CHUNKEDWORLD_H
+#define CHUNKEDWORLD_H
+
+#include <stddef.h>
+#include <algorithm>
+#include <functional>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "World.h"
+#include "BiomeTable.h"
+
+// square piece of an unbounded world; tile (0, 0) of chunk (x, y) is
+// tile (x * size, y * size) of the world
+struct Chunk
+{
+    int64_t x = 0, y = 0;
+    Grid<World::BIOME> tiles;
+    Grid<float> heightmap;
+
+    Chunk(unsigned size) : tiles(size, size), heightmap(size, size) {}
+};
+
+// serves an unbounded world as chunks that are generated on first request
+// and kept in a least recently used cache. Every tile depends only on its
+// world coordinates, so chunks match at their borders and cost the same
+// anywhere. There is no island falloff, and the region passes and rivers
+// of World, which need the whole map, are not applied
+class ChunkedWorld
+{
+public:
+    PerlinNoise2D *noise;
+
+    // optional, generates on the calling thread only when not set
+    ThreadPool *pool = nullptr;
+
+    // height offset like World::a; call clear() after changing it or noise
+    float a = 0.1f;
+
+    // optional, assigns the biomes by its rules instead of the default
+    // ones when set; call clear() after changing it
+    const BiomeTable *biomes = nullptr;
+
+    // hits and misses of getChunk()
+    unsigned long hits = 0, misses = 0;
+
+    ChunkedWorld(PerlinNoise2D *_noise, unsigned _chunkSize = 256,
+                 size_t memoryBudget = 64 << 20) :
+        noise(_noise), chunkSize(_chunkSize)
+    {
+        setMemoryBudget(memoryBudget);
+    }
+
+    // returns chunk (x, y), generating it when it is not cached; the chunk
+    // stays valid for as long as the caller holds it, even when evicted
+    std::shared_ptr<const Chunk> getChunk(int64_t x, int64_t y)
+    {
+        auto found = index.find(Key(x, y));
+        if(found != index.end())
+        {
+            ++hits;
+            lru.splice(lru.begin(), lru, found->second);
+            return *found->second;
+        }
+        ++misses;
+        std::shared_ptr<Chunk> chunk;
+        if(lru.size() >= capacity)
+        {
+            // reuse the buffers of the least recently used chunk unless a
+            // caller still holds it
+            if(lru.back().use_count() == 1)
+                chunk = lru.back();
+            index.erase(Key(lru.back()->x, lru.back()->y));
+            lru.pop_back();
+        }
+        if(!chunk)
+            chunk = std::make_shared<Chunk>(chunkSize);
+        generate(*chunk, x, y);
+        lru.push_front(chunk);
+        index[Key(x, y)] = lru.begin();
+        return chunk;
+    }
+
+    // biome of a tile in world coordinates
+    World::BIOME getTile(int64_t x, int64_t y)
+    {
+        int64_t cx = floorDiv(x), cy = floorDiv(y);
+        return getChunk(cx, cy)->tiles[y - cy * chunkSize][x - cx * chunkSize];
+    }
+
+    // fills chunk with chunk (x, y) without touching the cache
+    void generate(Chunk &chunk, int64_t x, int64_t y) const
+    {
+        unsigned bandCount = (chunkSize + World::BAND_ROWS - 1) / World::BAND_ROWS;
+        chunk.x = x;
+        chunk.y = y;
+        std::function<void(unsigned)> job = [&](unsigned i)
+        {
+            generateBand(chunk, i * World::BAND_ROWS,
+                         std::min((i + 1) * World::BAND_ROWS, chunkSize));
+        };
+        if(pool)
+            pool->run(bandCount, job);
+        else
+            for(unsigned i = 0; i < bandCount; ++i)
+                job(i);
+    }
+
+    // keeps as many chunks as fit in bytes, at least one; chunks held by
+    // callers after eviction are not counted
+    void setMemoryBudget(size_t bytes)
+    {
+        size_t chunkBytes = sizeof(Chunk) + (size_t) chunkSize * chunkSize *
+                            (sizeof(World::BIOME) + sizeof(float));
+        capacity = std::max(bytes / chunkBytes, (size_t) 1);
+        while(lru.size() > capacity)
+        {
+            index.erase(Key(lru.back()->x, lru.back()->y));
+            lru.pop_back();
+        }
+    }
+
+    void clear()
+    {
+        lru.clear();
+        index.clear();
+    }
+
+    unsigned getChunkSize() const
+    {
+        return chunkSize;
+    }
+
+    size_t getCapacity() const
+    {
+        return capacity;
+    }
+
+    size_t getSize() const
+    {
+        return lru.size();
+    }
+private:
+    typedef std::pair<int64_t, int64_t> Key;
+    typedef std::list<std::shared_ptr<Chunk>> Lru;
+
+    struct KeyHash
+    {
+        size_t operator()(const Key &key) const
+        {
+            return std::hash<int64_t>()(key.first * 73856093LL ^ key.second * 19349663LL);
+        }
+    };
+
+    unsigned chunkSize;
+    size_t capacity;
+    // most recently used first
+    Lru lru;
+    std::unordered_map<Key, Lru::iterator, KeyHash> index;
+
+    int64_t floorDiv(int64_t v) const
+    {
+        return v >= 0 ? v / (int64_t) chunkSize : (v + 1) / (int64_t) chunkSize - 1;
+    }
+
+    // height and biome for rows [y0, y1) of chunk, with the terrain rules
+    // of World::generateBand
+    void generateBand(Chunk &chunk, unsigned y0, unsigned y1) const
+    {
+        float elevation;
+        std::vector<float> heightRow(chunkSize), moistureRow(chunkSize);
+        const BiomeTable &table = biomes ? *biomes : BiomeTable::getDefault();
+        // 64 bit, long has 32 on some platforms
+        int64_t left = chunk.x * chunkSize, top = chunk.y * chunkSize;
+        for(unsigned y = y0; y < y1; ++y)
+        {
+            noise->getRowFar(heightRow.data(), chunkSize, left, top + y, World::scale);
+            noise->getRowFar(moistureRow.data(), chunkSize, left + 53, top + y + 71, 0.0625f);
+            for(unsigned x = 0; x < chunkSize; ++x)
+            {
+                elevation = World::remap(heightRow[x]) + a;
+                if(elevation < -1.0f)
+                    elevation = -1.0f;
+                chunk.heightmap[y][x] = elevation;
+                moistureRow[x] = World::remap(moistureRow[x]);
+            }
+            table.classify(chunk.heightmap[y], moistureRow.data(), chunk.tiles[y], chunkSize);
+        }
+    }
+};
+
+#endif // CHUNKEDWORLD_H
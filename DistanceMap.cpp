@@ -0,0 +1,268 @@
+#include "DistanceMap.h"
+#include <math.h>
+#include <algorithm>
+#include <functional>
+
+const unsigned DistanceMap::STRIP = 64;
+const unsigned DistanceMap::BAND_ROWS = 16;
+const uint32_t DistanceMap::NO_EDGE = ~0u;
+
+namespace
+{
+    // runs job(0) to job(count - 1) on pool, or in order without one
+    void runJobs(ThreadPool *pool, unsigned count, const std::function<void(unsigned)> &job)
+    {
+        if(pool)
+            pool->run(count, job);
+        else
+            for(unsigned i = 0; i < count; ++i)
+                job(i);
+    }
+}
+
+void DistanceMap::build(const World &world, ThreadPool *pool)
+{
+    width = world.getWidth();
+    height = world.getHeight();
+    static const unsigned targets[FIELD_COUNT] = {
+        1 << World::OCEAN | 1 << World::COAST | 1 << World::LAKE | 1 << World::RIVER,
+        1 << World::OCEAN,
+        1 << World::COAST,
+        1 << World::LAKE,
+        1 << World::RIVER
+    };
+    for(unsigned field = 0; field < FIELD_COUNT; ++field)
+    {
+        if(fields & 1 << field)
+        {
+            distances[field].resize(width, height);
+            transform(world.tiles, targets[field], distances[field], pool);
+        }
+        else
+            distances[field] = Grid<float>(0, 0);
+    }
+    traceCoastlines(world.getHeightmap());
+}
+
+// Meijster: the distances within every column, then along every row the
+// lower envelope of the parabolas they span
+void DistanceMap::transform(const Grid<World::BIOME> &tiles, unsigned biomes, Grid<float> &out,
+                            ThreadPool *pool)
+{
+    // farther than any two tiles, so a column without a target never wins
+    const uint32_t far = width + height;
+    vertical.resize(width, height);
+    runJobs(pool, (width + STRIP - 1) / STRIP, [&](unsigned strip)
+    {
+        unsigned x0 = strip * STRIP, x1 = std::min(x0 + STRIP, width);
+        for(unsigned y = 0; y < height; ++y)
+        {
+            const World::BIOME *row = tiles[y];
+            uint32_t *distance = vertical[y];
+            const uint32_t *above = y > 0 ? vertical[y - 1] : nullptr;
+            for(unsigned x = x0; x < x1; ++x)
+                distance[x] = biomes >> row[x] & 1 ? 0 : above ? std::min(above[x] + 1, far) : far;
+        }
+        for(unsigned y = height - 1; y-- > 0;)
+        {
+            uint32_t *distance = vertical[y];
+            const uint32_t *below = vertical[y + 1];
+            for(unsigned x = x0; x < x1; ++x)
+                distance[x] = std::min(distance[x], below[x] + 1);
+        }
+    });
+    const int64_t none = (int64_t) far * far;
+    runJobs(pool, (height + BAND_ROWS - 1) / BAND_ROWS, [&](unsigned band)
+    {
+        // parabola s[k] is the lowest from column t[k] up to t[k + 1]
+        std::vector<uint32_t> s(width), t(width);
+        std::vector<int64_t> f(width);
+        unsigned y1 = std::min((band + 1) * BAND_ROWS, height);
+        for(unsigned y = band * BAND_ROWS; y < y1; ++y)
+        {
+            const uint32_t *distance = vertical[y];
+            for(unsigned q = 0; q < width; ++q)
+                f[q] = (int64_t) distance[q] * distance[q];
+            auto parabola = [&](int64_t x, uint32_t i)
+            {
+                return (x - i) * (x - i) + f[i];
+            };
+            // first column where the parabola of u is below the one of i
+            auto separation = [&](int64_t i, int64_t u)
+            {
+                // both are below 2^53 and the divisor below 2^33, so the
+                // quotient is never rounded across an integer
+                int64_t numerator = u * u - i * i + f[u] - f[i];
+                return (int64_t) floor((double) numerator / (double) (2 * (u - i))) + 1;
+            };
+            // everything but the start of a new parabola is decided
+            // without a division
+            long k = 0;
+            s[0] = t[0] = 0;
+            for(uint32_t u = 1; u < width; ++u)
+            {
+                while(k >= 0 && parabola(t[k], s[k]) > parabola(t[k], u))
+                    --k;
+                if(k < 0)
+                {
+                    k = 0;
+                    s[0] = u;
+                }
+                else
+                {
+                    int64_t w = separation(s[k], u);
+                    if(w < width)
+                    {
+                        ++k;
+                        s[k] = u;
+                        t[k] = w;
+                    }
+                }
+            }
+            float *row = out[y];
+            for(uint32_t u = width; u-- > 0;)
+            {
+                int64_t squared = parabola(u, s[k]);
+                row[u] = squared >= none ? INFINITY : sqrtf((float) squared);
+                if(u == t[k])
+                    --k;
+            }
+        }
+    });
+}
+
+void DistanceMap::traceCoastlines(const Grid<float> &heights)
+{
+    coastlines.clear();
+    points.clear();
+    if(width < 2 || height < 2)
+        return;
+    const uint32_t horizontal = (width - 1) * height;
+    const size_t edges = (size_t) horizontal + (size_t) width * (height - 1);
+    // walking a coastline unlinks its edges, so links is all NO_EDGE
+    // again after every trace and only needs to be filled on a resize
+    if(links.size() != 2 * edges)
+        links.assign(2 * edges, NO_EDGE);
+    crossings.clear();
+    auto attach = [&](uint32_t edge, uint32_t other)
+    {
+        if(links[2 * edge] == NO_EDGE)
+        {
+            links[2 * edge] = other;
+            crossings.push_back(edge);
+        }
+        else
+            links[2 * edge + 1] = other;
+    };
+    auto link = [&](uint32_t first, uint32_t second)
+    {
+        attach(first, second);
+        attach(second, first);
+    };
+    const float level = coastLevel;
+    for(unsigned y = 0; y + 1 < height; ++y)
+    {
+        const float *upper = heights[y], *lower = heights[y + 1];
+        for(unsigned x = 0; x + 1 < width; ++x)
+        {
+            // corners at or above the level are land
+            unsigned corners = (upper[x] >= level) << 3 | (upper[x + 1] >= level) << 2 |
+                               (lower[x + 1] >= level) << 1 | (lower[x] >= level);
+            if(corners == 0 || corners == 15)
+                continue;
+            uint32_t top = y * (width - 1) + x, bottom = top + width - 1;
+            uint32_t left = horizontal + y * width + x, right = left + 1;
+            // a segment separates the corners on each side of it; case c
+            // and 15 - c have the same segments
+            bool landCenter = upper[x] + upper[x + 1] + lower[x + 1] + lower[x] >= 4 * level;
+            switch(corners < 8 ? corners : 15 - corners)
+            {
+                case 1:
+                    link(left, bottom);
+                    break;
+                case 2:
+                    link(bottom, right);
+                    break;
+                case 3:
+                    link(left, right);
+                    break;
+                case 4:
+                    link(top, right);
+                    break;
+                case 5:
+                    // saddle; the center decides which diagonal connects
+                    if(landCenter == (corners == 5))
+                    {
+                        link(left, top);
+                        link(bottom, right);
+                    }
+                    else
+                    {
+                        link(top, right);
+                        link(left, bottom);
+                    }
+                    break;
+                case 6:
+                    link(top, bottom);
+                    break;
+                case 7:
+                    link(left, top);
+                    break;
+            }
+        }
+    }
+    auto walk = [&](uint32_t start)
+    {
+        Coastline coastline = {(uint32_t) points.size(), 0, false};
+        uint32_t previous = NO_EDGE, current = start;
+        while(true)
+        {
+            points.push_back(edgePoint(heights, current));
+            uint32_t first = links[2 * current], second = links[2 * current + 1];
+            uint32_t next = first != NO_EDGE && first != previous ? first :
+                            second != previous ? second : NO_EDGE;
+            links[2 * current] = links[2 * current + 1] = NO_EDGE;
+            if(next == NO_EDGE || next == start)
+            {
+                coastline.closed = next == start;
+                break;
+            }
+            previous = current;
+            current = next;
+        }
+        coastline.count = points.size() - coastline.first;
+        coastlines.push_back(coastline);
+    };
+    // open coastlines start at the edge of the map, where an edge has a
+    // single segment; everything left are loops
+    for(uint32_t edge : crossings)
+        if(links[2 * edge] != NO_EDGE && links[2 * edge + 1] == NO_EDGE)
+            walk(edge);
+    for(uint32_t edge : crossings)
+        if(links[2 * edge] != NO_EDGE)
+            walk(edge);
+}
+
+DistanceMap::Point DistanceMap::edgePoint(const Grid<float> &heights, uint32_t edge) const
+{
+    uint32_t horizontal = (width - 1) * height;
+    unsigned x0, y0, x1, y1;
+    if(edge < horizontal)
+    {
+        x0 = edge % (width - 1);
+        y0 = edge / (width - 1);
+        x1 = x0 + 1;
+        y1 = y0;
+    }
+    else
+    {
+        x0 = (edge - horizontal) % width;
+        y0 = (edge - horizontal) / width;
+        x1 = x0;
+        y1 = y0 + 1;
+    }
+    float h0 = heights[y0][x0], h1 = heights[y1][x1];
+    float t = (coastLevel - h0) / (h1 - h0);
+    Point point = {x0 + t * (x1 - x0), y0 + t * (y1 - y0)};
+    return point;
+}
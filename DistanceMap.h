@@ -0,0 +1,106 @@
+#ifndef DISTANCEMAP_H
+#define DISTANCEMAP_H
+
+#include <stdint.h>
+#include <vector>
+#include "World.h"
+
+// exact euclidean distances from every tile to the closest tile of the
+// water biomes, and the coastlines of the heightmap as polylines; both
+// are computed in time linear in the number of tiles
+class DistanceMap
+{
+public:
+    // targets of the distance fields; WATER is any of the others
+    enum FIELD
+    {
+        WATER,
+        OCEAN,
+        COAST,
+        LAKE,
+        RIVER,
+        FIELD_COUNT
+    };
+
+    // a corner of a coastline in tile coordinates
+    struct Point
+    {
+        float x, y;
+    };
+
+    // points[first] up to points[first + count]; a closed coastline
+    // continues from its last point to its first, an open one ends at the
+    // edge of the map
+    struct Coastline
+    {
+        uint32_t first, count;
+        bool closed;
+    };
+
+    // fields computed by build(), one bit per FIELD
+    unsigned fields = (1 << FIELD_COUNT) - 1;
+
+    // height the coastlines follow; the heightmap is below it in water,
+    // so lake shores are coastlines as well
+    float coastLevel = 0.0f;
+
+    // computes the fields and coastlines of world, reusing the buffers of
+    // the last build; the distance transforms run on pool when set
+    void build(const World &world, ThreadPool *pool = nullptr);
+
+    bool hasField(FIELD field) const
+    {
+        return distances[field].getWidth() == width && width > 0;
+    }
+
+    // distance in tiles from tile (x, y) to the closest tile of field,
+    // zero on such a tile and infinity when the world has none
+    float getDistance(FIELD field, unsigned x, unsigned y) const
+    {
+        return distances[field][y][x];
+    }
+
+    const Grid<float> &getField(FIELD field) const
+    {
+        return distances[field];
+    }
+
+    unsigned getCoastlineCount() const
+    {
+        return coastlines.size();
+    }
+
+    const Coastline &getCoastline(unsigned i) const
+    {
+        return coastlines[i];
+    }
+
+    const Point *getPoints(const Coastline &coastline) const
+    {
+        return points.data() + coastline.first;
+    }
+private:
+    static const unsigned STRIP, BAND_ROWS;
+    static const uint32_t NO_EDGE;
+
+    unsigned width = 0, height = 0;
+    Grid<float> distances[FIELD_COUNT] = {Grid<float>(0, 0), Grid<float>(0, 0), Grid<float>(0, 0),
+                                          Grid<float>(0, 0), Grid<float>(0, 0)};
+    // distance to the closest target in the same column
+    Grid<uint32_t> vertical = Grid<uint32_t>(0, 0);
+    std::vector<Coastline> coastlines;
+    std::vector<Point> points;
+    // the two coastline segments through every cell edge: horizontal
+    // edges first, row by row, then vertical ones; crossings lists the
+    // edges with a segment in the order they were found
+    std::vector<uint32_t> links, crossings;
+
+    // distances to the tiles whose biome has its bit in biomes
+    void transform(const Grid<World::BIOME> &tiles, unsigned biomes, Grid<float> &out,
+                   ThreadPool *pool);
+    // marching squares over the cells between four tiles of heights
+    void traceCoastlines(const Grid<float> &heights);
+    Point edgePoint(const Grid<float> &heights, uint32_t edge) const;
+};
+
+#endif // DISTANCEMAP_H
@@ -0,0 +1,215 @@
+#ifndef EROSION_H
+#define EROSION_H
+
+#include <stdint.h>
+#include <math.h>
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include "Grid.h"
+#include "ThreadPool.h"
+#include "Random.h"
+
+// particle based hydraulic erosion followed by thermal talus on a
+// heightmap. Droplets start on square blocks of the map and may not leave
+// the block and a margin of half a block around it; blocks are processed
+// in four phases of blocks two blocks apart, so the blocks of one phase
+// never touch the same tiles and run in parallel. Every block draws its
+// droplets from its own random sequence, so the result depends only on
+// the seed, not on the number of threads
+class Erosion
+{
+public:
+    // droplets started per tile
+    float density = 0.3f;
+    // steps of one droplet at most
+    unsigned lifetime = 40;
+    // how much of its direction a droplet keeps against the slope
+    float inertia = 0.1f;
+    // sediment a droplet can carry per unit of drop, speed and water
+    float capacity = 4.0f, minCapacity = 0.0001f;
+    float erodeRate = 0.3f, depositRate = 0.3f;
+    float evaporation = 0.03f, gravity = 4.0f;
+    // droplets that reach water below this height drop their sediment
+    float seaLevel = 0.0f;
+    // smoothing passes that move material down every slope steeper than
+    // talus per tile
+    unsigned thermalPasses = 8;
+    float talus = 0.01f, thermalRate = 0.5f;
+
+    void run(Grid<float> &heights, unsigned long seed, ThreadPool *pool = nullptr)
+    {
+        hydraulic(heights, seed, pool);
+        for(unsigned i = 0; i < thermalPasses; ++i)
+            thermal(heights, pool);
+    }
+private:
+    static const unsigned BLOCK = 64, MARGIN = BLOCK / 2, BAND_ROWS = 16;
+
+    // copy of the heights for the thermal passes
+    Grid<float> previous = Grid<float>(0, 0);
+
+    void hydraulic(Grid<float> &heights, unsigned long seed, ThreadPool *pool) const
+    {
+        unsigned width = heights.getWidth(), height = heights.getHeight();
+        if(width < 2 || height < 2 || density <= 0.0f)
+            return;
+        unsigned columns = (width + BLOCK - 1) / BLOCK, rows = (height + BLOCK - 1) / BLOCK;
+        for(unsigned phase = 0; phase < 4; ++phase)
+        {
+            std::vector<unsigned> blocks;
+            for(unsigned by = phase / 2; by < rows; by += 2)
+                for(unsigned bx = phase % 2; bx < columns; bx += 2)
+                    blocks.push_back(by * columns + bx);
+            std::function<void(unsigned)> job = [&](unsigned i)
+            {
+                erodeBlock(heights, seed, blocks[i] % columns, blocks[i] / columns);
+            };
+            if(pool)
+                pool->run(blocks.size(), job);
+            else
+                for(unsigned i = 0; i < blocks.size(); ++i)
+                    job(i);
+        }
+    }
+
+    void erodeBlock(Grid<float> &heights, unsigned long seed, unsigned bx, unsigned by) const
+    {
+        unsigned width = heights.getWidth(), height = heights.getHeight();
+        float *cells = heights.data();
+        unsigned x0 = bx * BLOCK, y0 = by * BLOCK;
+        unsigned x1 = std::min(x0 + BLOCK, width), y1 = std::min(y0 + BLOCK, height);
+        // droplets stay where bilinear reads and writes keep inside
+        // [left, right] x [top, bottom]
+        float left = x0 > MARGIN ? x0 - MARGIN : 0.0f;
+        float top = y0 > MARGIN ? y0 - MARGIN : 0.0f;
+        float right = std::min(x1 + MARGIN, width) - 1.0f;
+        float bottom = std::min(y1 + MARGIN, height) - 1.0f;
+        uint64_t state = seed * 0x9e3779b97f4a7c15ULL ^ ((uint64_t) by << 32 | bx);
+        unsigned droplets = (unsigned) (density * (x1 - x0) * (y1 - y0));
+        for(unsigned d = 0; d < droplets; ++d)
+        {
+            float x = x0 + nextFloat(state) * (x1 - x0);
+            float y = y0 + nextFloat(state) * (y1 - y0);
+            float dx = 0.0f, dy = 0.0f, speed = 1.0f, water = 1.0f, sediment = 0.0f;
+            for(unsigned step = 0; step < lifetime; ++step)
+            {
+                if(!(x >= left && x < right && y >= top && y < bottom))
+                    break;
+                unsigned ix = (unsigned) x, iy = (unsigned) y;
+                float u = x - ix, v = y - iy;
+                size_t index = (size_t) iy * width + ix;
+                float h00 = cells[index], h10 = cells[index + 1];
+                float h01 = cells[index + width], h11 = cells[index + width + 1];
+                float here = h00 * (1 - u) * (1 - v) + h10 * u * (1 - v) +
+                             h01 * (1 - u) * v + h11 * u * v;
+                if(here < seaLevel)
+                {
+                    deposit(cells, index, width, u, v, sediment);
+                    break;
+                }
+                float gx = (h10 - h00) * (1 - v) + (h11 - h01) * v;
+                float gy = (h01 - h00) * (1 - u) + (h11 - h10) * u;
+                dx = dx * inertia - gx * (1 - inertia);
+                dy = dy * inertia - gy * (1 - inertia);
+                float length = sqrtf(dx * dx + dy * dy);
+                if(length == 0.0f)
+                    break;
+                dx *= 1.0f / length;
+                dy *= 1.0f / length;
+                float nx = x + dx, ny = y + dy;
+                if(!(nx >= left && nx < right && ny >= top && ny < bottom))
+                {
+                    deposit(cells, index, width, u, v, sediment);
+                    break;
+                }
+                float drop = here - sample(cells, width, nx, ny);
+                float carry = std::max(drop * speed * water * capacity, minCapacity);
+                if(drop < 0.0f || sediment > carry)
+                {
+                    // uphill fills the pit behind, otherwise drop the excess
+                    float amount = drop < 0.0f ? std::min(-drop, sediment) :
+                                   (sediment - carry) * depositRate;
+                    deposit(cells, index, width, u, v, amount);
+                    sediment -= amount;
+                }
+                else
+                {
+                    // never dig below the next position
+                    float amount = std::min((carry - sediment) * erodeRate, drop);
+                    deposit(cells, index, width, u, v, -amount);
+                    sediment += amount;
+                }
+                speed = sqrtf(std::max(speed * speed + drop * gravity, 0.0f));
+                water *= 1.0f - evaporation;
+                x = nx;
+                y = ny;
+            }
+        }
+    }
+
+    static float sample(const float *cells, unsigned width, float x, float y)
+    {
+        unsigned ix = (unsigned) x, iy = (unsigned) y;
+        float u = x - ix, v = y - iy;
+        const float *row = cells + (size_t) iy * width + ix;
+        return row[0] * (1 - u) * (1 - v) + row[1] * u * (1 - v) +
+               row[width] * (1 - u) * v + row[width + 1] * u * v;
+    }
+
+    // adds amount to the four tiles around a position, weighted bilinearly
+    static void deposit(float *cells, size_t index, unsigned width, float u, float v,
+                        float amount)
+    {
+        cells[index] += amount * (1 - u) * (1 - v);
+        cells[index + 1] += amount * u * (1 - v);
+        cells[index + width] += amount * (1 - u) * v;
+        cells[index + width + 1] += amount * u * v;
+    }
+
+    // moves an eighth of the excess over talus down every slope; every
+    // tile is computed from the previous heights, so rows run in parallel
+    void thermal(Grid<float> &heights, ThreadPool *pool)
+    {
+        unsigned width = heights.getWidth(), height = heights.getHeight();
+        previous.resize(width, height);
+        std::copy(heights.data(), heights.data() + (size_t) width * height, previous.data());
+        const float rate = thermalRate * 0.125f, t = talus;
+        // the part of a height difference beyond talus, with its sign
+        auto flow = [t](float difference)
+        {
+            return std::max(difference - t, 0.0f) + std::min(difference + t, 0.0f);
+        };
+        std::function<void(unsigned)> job = [&](unsigned band)
+        {
+            unsigned y1 = std::min((band + 1) * BAND_ROWS, height);
+            for(unsigned y = band * BAND_ROWS; y < y1; ++y)
+            {
+                // outside the map counts as level ground
+                const float *row = previous[y];
+                const float *up = y > 0 ? previous[y - 1] : row;
+                const float *down = y < height - 1 ? previous[y + 1] : row;
+                float *out = heights[y];
+                auto tile = [&](unsigned x, float left, float right)
+                {
+                    float h = row[x];
+                    out[x] = h + rate * (flow(up[x] - h) + flow(down[x] - h) +
+                                         flow(left - h) + flow(right - h));
+                };
+                tile(0, row[0], row[std::min(1u, width - 1)]);
+                for(unsigned x = 1; x + 1 < width; ++x)
+                    tile(x, row[x - 1], row[x + 1]);
+                if(width > 1)
+                    tile(width - 1, row[width - 2], row[width - 1]);
+            }
+        };
+        unsigned bands = (height + BAND_ROWS - 1) / BAND_ROWS;
+        if(pool)
+            pool->run(bands, job);
+        else
+            for(unsigned i = 0; i < bands; ++i)
+                job(i);
+    }
+};
+
+#endif // EROSION_H
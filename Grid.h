@@ -0,0 +1,95 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+// width x height cells in one contiguous allocation, indexed as grid[y][x]
+template<class T>
+class Grid
+{
+private:
+    unsigned width, height;
+    std::vector<T> cells;
+public:
+    Grid(unsigned _width, unsigned _height) :
+        width(_width), height(_height), cells((size_t) _width * _height) {}
+
+    T *operator[](unsigned y)
+    {
+        return &cells[(size_t) y * width];
+    }
+
+    const T *operator[](unsigned y) const
+    {
+        return &cells[(size_t) y * width];
+    }
+
+    T *data()
+    {
+        return cells.data();
+    }
+
+    const T *data() const
+    {
+        return cells.data();
+    }
+
+    void fill(T value)
+    {
+        std::fill(cells.begin(), cells.end(), value);
+    }
+
+    // contents are unspecified after a change of size
+    void resize(unsigned _width, unsigned _height)
+    {
+        width = _width;
+        height = _height;
+        cells.resize((size_t) _width * _height);
+    }
+
+    unsigned getWidth() const
+    {
+        return width;
+    }
+
+    unsigned getHeight() const
+    {
+        return height;
+    }
+};
+
+// one bit per cell; rows start on a word boundary, so threads can write
+// disjoint rows without sharing words
+class BitGrid
+{
+private:
+    unsigned width, height;
+    size_t rowWords;
+    std::vector<uint64_t> words;
+public:
+    BitGrid(unsigned _width, unsigned _height) :
+        width(_width), height(_height), rowWords((_width + 63) / 64),
+        words(rowWords * _height) {}
+
+    bool get(unsigned x, unsigned y) const
+    {
+        return (words[y * rowWords + x / 64] >> (x % 64)) & 1;
+    }
+
+    void set(unsigned x, unsigned y, bool value)
+    {
+        uint64_t &word = words[y * rowWords + x / 64];
+        uint64_t bit = (uint64_t) 1 << (x % 64);
+        word = value ? word | bit : word & ~bit;
+    }
+
+    void fill(bool value)
+    {
+        std::fill(words.begin(), words.end(), value ? ~(uint64_t) 0 : 0);
+    }
+};
+
+#endif // GRID_H
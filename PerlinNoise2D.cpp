@@ -0,0 +1,3 @@
+#include "PerlinNoise2D.h"
+
+const unsigned PerlinNoise2D::MAX_OCTAVES = 7;
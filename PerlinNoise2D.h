@@ -0,0 +1,649 @@
+#ifndef PERLINNOISE2D_H
+#define PERLINNOISE2D_H
+
+#include <stdlib.h>
+#include <time.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+#include "Random.h"
+#if !defined(PERLIN_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#include <immintrin.h>
+#define PERLIN_SIMD
+#endif
+
+class PerlinNoise2D
+{
+public:
+    // how lattice points are hashed to gradients
+    enum HASH
+    {
+        POLYNOMIAL, // value() and value2(), reproduces existing seeds
+        PERMUTATION // seeded permutation and gradient tables
+    };
+private:
+    unsigned octaves;
+    unsigned long seed;
+    HASH hash;
+    // PERMUTATION only; the permutation is stored twice, so the second
+    // lookup of a hash needs no wrap
+    std::vector<int> permutation;
+    std::vector<float> gradientX, gradientY;
+
+    double value(long x, long y) const
+    {
+        unsigned long n = x + y * 563;
+        n = ((n + seed) << 13) ^ n;
+        return (1.0 - ((n * (n * n * 15731 + 789221) + seed) & 0x7fffffff) / 1073741824.0);
+    }
+
+    double value2(long x, long y) const
+    {
+        unsigned long n = y + x * 367;
+        n = ((n + seed) << 11) ^ n;
+        return (1.0 - ((n * (n * n * 20183 + 815279) + seed) & 0x7fffffff) / 1073741824.0);
+    }
+
+    float LinearInterpolate(float a, float b, float c) const
+    {
+        return a + c * (b - a);
+    }
+
+    inline int fastFloor(float x) const
+    {
+        return x > 0 ? (int) x : (int) x - 1;
+    }
+
+    inline float dot(float gx, float gy, float x, float y) const
+    {
+        return gx * x + gy * y;
+    }
+
+    // side of the PERMUTATION tables; the pattern of an octave repeats
+    // every TABLE_SIZE lattice cells
+    static const unsigned TABLE_SIZE = 1024;
+
+    // shuffles the permutation and draws gradient components uniformly
+    // from [-1, 1] like value() and value2() do
+    void buildTables()
+    {
+        uint64_t state = seed;
+        permutation.resize(TABLE_SIZE * 2);
+        gradientX.resize(TABLE_SIZE);
+        gradientY.resize(TABLE_SIZE);
+        for(unsigned i = 0; i < TABLE_SIZE; ++i)
+            permutation[i] = i;
+        for(unsigned i = TABLE_SIZE - 1; i > 0; --i)
+            std::swap(permutation[i], permutation[nextRandom(state) % (i + 1)]);
+        for(unsigned i = 0; i < TABLE_SIZE; ++i)
+        {
+            permutation[i + TABLE_SIZE] = permutation[i];
+            gradientX[i] = (float) ((nextRandom(state) >> 11) * (2.0 / 9007199254740992.0) - 1.0);
+            gradientY[i] = (float) ((nextRandom(state) >> 11) * (2.0 / 9007199254740992.0) - 1.0);
+        }
+    }
+
+    // the hash policies give the gradient of lattice point (x, y), for one
+    // point or for every lane of a SIMD register
+
+    struct PolynomialHash
+    {
+        static void gradient(const PerlinNoise2D &noise, long x, long y, float &gx, float &gy)
+        {
+            gx = noise.value(x, y);
+            gy = noise.value2(x, y);
+        }
+
+#ifdef PERLIN_SIMD
+        // the hashes only use +, *, << , ^ and &, so the low 32 bits of
+        // the result depend only on the low 32 bits of the operands; that
+        // makes 32 bit lanes give exactly the same values as the unsigned
+        // long math. 1 - h / 2^30 is computed as (2^30 - h) * 2^-30, which
+        // rounds exactly once just like the double expression converted
+        // to float
+        template<class V>
+        static void gradient(const PerlinNoise2D &noise, typename V::I x, typename V::I y,
+                             typename V::F &gx, typename V::F &gy)
+        {
+            const typename V::I s = V::set((int) noise.seed);
+            const typename V::I low31 = V::set(0x7fffffff), one = V::set(1 << 30);
+            const typename V::F norm = V::set(1.0f / 1073741824.0f);
+            typename V::I n = V::add(x, V::mul(y, V::set(563)));
+            n = V::bitXor(V::template shiftLeft<13>(V::add(n, s)), n);
+            n = V::mul(n, V::add(V::mul(V::mul(n, n), V::set(15731)), V::set(789221)));
+            n = V::bitAnd(V::add(n, s), low31);
+            gx = V::mul(V::toFloat(V::sub(one, n)), norm);
+            n = V::add(y, V::mul(x, V::set(367)));
+            n = V::bitXor(V::template shiftLeft<11>(V::add(n, s)), n);
+            n = V::mul(n, V::add(V::mul(V::mul(n, n), V::set(20183)), V::set(815279)));
+            n = V::bitAnd(V::add(n, s), low31);
+            gy = V::mul(V::toFloat(V::sub(one, n)), norm);
+        }
+#endif
+    };
+
+    // two table lookups instead of two cubic hashes; the low bits of a
+    // long and of its 32 bit lane are the same, so both paths agree
+    struct PermutationHash
+    {
+        static void gradient(const PerlinNoise2D &noise, long x, long y, float &gx, float &gy)
+        {
+            const int mask = TABLE_SIZE - 1;
+            int i = noise.permutation[noise.permutation[x & mask] + (y & mask)];
+            gx = noise.gradientX[i];
+            gy = noise.gradientY[i];
+        }
+
+#ifdef PERLIN_SIMD
+        template<class V>
+        static void gradient(const PerlinNoise2D &noise, typename V::I x, typename V::I y,
+                             typename V::F &gx, typename V::F &gy)
+        {
+            const typename V::I mask = V::set((int) TABLE_SIZE - 1);
+            typename V::I i = V::gather(noise.permutation.data(), V::bitAnd(x, mask));
+            i = V::gather(noise.permutation.data(), V::add(i, V::bitAnd(y, mask)));
+            gx = V::gather(noise.gradientX.data(), i);
+            gy = V::gather(noise.gradientY.data(), i);
+        }
+#endif
+    };
+
+    template<class H>
+    float interpolatedNoise(float x, float y) const
+    {
+        long integerX = fastFloor(x);
+        long integerY = fastFloor(y);
+        return latticeNoise<H>(integerX, integerY, x - integerX, y - integerY);
+    }
+
+    // noise at fraction (fx, fy) of the lattice cell (integerX, integerY)
+    template<class H>
+    float latticeNoise(long integerX, long integerY, float fx, float fy) const
+    {
+        float tx = fx * fx * fx * (fx * (fx * 6 - 15) + 10);
+        float ty = fy * fy * fy * (fy * (fy * 6 - 15) + 10);
+        float gx00, gy00, gx10, gy10, gx01, gy01, gx11, gy11;
+        H::gradient(*this, integerX, integerY, gx00, gy00);
+        H::gradient(*this, integerX + 1, integerY, gx10, gy10);
+        H::gradient(*this, integerX, integerY + 1, gx01, gy01);
+        H::gradient(*this, integerX + 1, integerY + 1, gx11, gy11);
+        return LinearInterpolate(LinearInterpolate(dot(gx00, gy00, fx    , fy),
+                                                   dot(gx10, gy10, fx - 1, fy),
+                                                   tx),
+                                 LinearInterpolate(dot(gx01, gy01, fx    , fy - 1),
+                                                   dot(gx11, gy11, fx - 1, fy - 1),
+                                                   tx),
+                                 ty);
+    }
+
+    // batch kernels work on fixed size chunks of sample points,
+    // so the coordinate and accumulator buffers can live on the stack
+    static const unsigned CHUNK = 64;
+
+    // adds amplitude * interpolatedNoise(px * frequency, py * frequency)
+    // to total for every point of the chunk
+    template<class H>
+    void octaveScalar(const float *px, const float *py, float *total,
+                      unsigned count, float frequency, float amplitude) const
+    {
+        for(unsigned i = 0; i < count; ++i)
+            total[i] += interpolatedNoise<H>(px[i] * frequency, py[i] * frequency) * amplitude;
+    }
+
+#ifdef PERLIN_SIMD
+    struct LanesSSE
+    {
+        typedef __m128 F;
+        typedef __m128i I;
+        static const unsigned SIZE = 4;
+
+        static F load(const float *p) { return _mm_load_ps(p); }
+        static I load(const int *p) { return _mm_load_si128((const __m128i *) p); }
+        static void store(float *p, F v) { _mm_store_ps(p, v); }
+        static F set(float v) { return _mm_set1_ps(v); }
+        static I set(int v) { return _mm_set1_epi32(v); }
+        static F add(F a, F b) { return _mm_add_ps(a, b); }
+        static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+        static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+        static F greater(F a, F b) { return _mm_cmpgt_ps(a, b); }
+        static I truncate(F v) { return _mm_cvttps_epi32(v); }
+        static F toFloat(I v) { return _mm_cvtepi32_ps(v); }
+        static I mask(F v) { return _mm_castps_si128(v); }
+        static I add(I a, I b) { return _mm_add_epi32(a, b); }
+        static I sub(I a, I b) { return _mm_sub_epi32(a, b); }
+        static I bitAnd(I a, I b) { return _mm_and_si128(a, b); }
+        static I bitXor(I a, I b) { return _mm_xor_si128(a, b); }
+        template<int S>
+        static I shiftLeft(I v) { return _mm_slli_epi32(v, S); }
+        static I gather(const int *table, I index)
+        {
+            alignas(16) int i[4];
+            _mm_store_si128((__m128i *) i, index);
+            return _mm_setr_epi32(table[i[0]], table[i[1]], table[i[2]], table[i[3]]);
+        }
+        static F gather(const float *table, I index)
+        {
+            alignas(16) int i[4];
+            _mm_store_si128((__m128i *) i, index);
+            return _mm_setr_ps(table[i[0]], table[i[1]], table[i[2]], table[i[3]]);
+        }
+        static I mul(I a, I b)
+        {
+#ifdef __SSE4_1__
+            return _mm_mullo_epi32(a, b);
+#else
+            __m128i even = _mm_mul_epu32(a, b);
+            __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+            return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                                      _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+#endif
+        }
+    };
+
+#ifdef __AVX2__
+    struct LanesAVX
+    {
+        typedef __m256 F;
+        typedef __m256i I;
+        static const unsigned SIZE = 8;
+
+        static F load(const float *p) { return _mm256_load_ps(p); }
+        static I load(const int *p) { return _mm256_load_si256((const __m256i *) p); }
+        static void store(float *p, F v) { _mm256_store_ps(p, v); }
+        static F set(float v) { return _mm256_set1_ps(v); }
+        static I set(int v) { return _mm256_set1_epi32(v); }
+        static F add(F a, F b) { return _mm256_add_ps(a, b); }
+        static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+        static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+        static F greater(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+        static I truncate(F v) { return _mm256_cvttps_epi32(v); }
+        static F toFloat(I v) { return _mm256_cvtepi32_ps(v); }
+        static I mask(F v) { return _mm256_castps_si256(v); }
+        static I add(I a, I b) { return _mm256_add_epi32(a, b); }
+        static I sub(I a, I b) { return _mm256_sub_epi32(a, b); }
+        static I bitAnd(I a, I b) { return _mm256_and_si256(a, b); }
+        static I bitXor(I a, I b) { return _mm256_xor_si256(a, b); }
+        template<int S>
+        static I shiftLeft(I v) { return _mm256_slli_epi32(v, S); }
+        static I mul(I a, I b) { return _mm256_mullo_epi32(a, b); }
+        static I gather(const int *table, I index) { return _mm256_i32gather_epi32(table, index, 4); }
+        static F gather(const float *table, I index) { return _mm256_i32gather_ps(table, index, 4); }
+    };
+    typedef LanesAVX Lanes;
+#else
+    typedef LanesSSE Lanes;
+#endif
+
+    // same operations in the same order as latticeNoise(), so results
+    // are bit-identical to the scalar path
+    template<class V, class H>
+    typename V::F latticeSIMD(typename V::I ix, typename V::I iy,
+                              typename V::F fx, typename V::F fy) const
+    {
+        typedef typename V::F F;
+        typedef typename V::I I;
+        const F c6 = V::set(6.0f), c15 = V::set(15.0f), c10 = V::set(10.0f), c1 = V::set(1.0f);
+        const I i1 = V::set(1);
+        F tx = V::mul(V::mul(V::mul(fx, fx), fx),
+                      V::add(V::mul(fx, V::sub(V::mul(fx, c6), c15)), c10));
+        F ty = V::mul(V::mul(V::mul(fy, fy), fy),
+                      V::add(V::mul(fy, V::sub(V::mul(fy, c6), c15)), c10));
+        F fx1 = V::sub(fx, c1), fy1 = V::sub(fy, c1);
+        I ix1 = V::add(ix, i1), iy1 = V::add(iy, i1);
+        F gx, gy;
+        H::template gradient<V>(*this, ix, iy, gx, gy);
+        F d00 = V::add(V::mul(gx, fx), V::mul(gy, fy));
+        H::template gradient<V>(*this, ix1, iy, gx, gy);
+        F d10 = V::add(V::mul(gx, fx1), V::mul(gy, fy));
+        H::template gradient<V>(*this, ix, iy1, gx, gy);
+        F d01 = V::add(V::mul(gx, fx), V::mul(gy, fy1));
+        H::template gradient<V>(*this, ix1, iy1, gx, gy);
+        F d11 = V::add(V::mul(gx, fx1), V::mul(gy, fy1));
+        F top = V::add(d00, V::mul(tx, V::sub(d10, d00)));
+        F bottom = V::add(d01, V::mul(tx, V::sub(d11, d01)));
+        return V::add(top, V::mul(ty, V::sub(bottom, top)));
+    }
+
+    // same as interpolatedNoise() for every point of the chunk
+    template<class V, class H>
+    void octaveSIMD(const float *px, const float *py, float *total,
+                    unsigned count, float frequency, float amplitude) const
+    {
+        typedef typename V::F F;
+        typedef typename V::I I;
+        const F freq = V::set(frequency), amp = V::set(amplitude), zero = V::set(0.0f);
+        const I i1 = V::set(1);
+        for(unsigned i = 0; i < count; i += V::SIZE)
+        {
+            F x = V::mul(V::load(px + i), freq);
+            F y = V::mul(V::load(py + i), freq);
+            // fastFloor: (int) x, minus one unless x > 0
+            I ix = V::sub(V::sub(V::truncate(x), i1), V::mask(V::greater(x, zero)));
+            I iy = V::sub(V::sub(V::truncate(y), i1), V::mask(V::greater(y, zero)));
+            F n = latticeSIMD<V, H>(ix, iy, V::sub(x, V::toFloat(ix)), V::sub(y, V::toFloat(iy)));
+            V::store(total + i, V::add(V::load(total + i), V::mul(n, amp)));
+        }
+    }
+
+    // same as latticeNoise() for every point of the chunk
+    template<class V, class H>
+    void octaveLatticeSIMD(const int *ix, const int *iy, const float *fx, const float *fy,
+                           float *total, unsigned count, float amplitude) const
+    {
+        const typename V::F amp = V::set(amplitude);
+        for(unsigned i = 0; i < count; i += V::SIZE)
+        {
+            typename V::F n = latticeSIMD<V, H>(V::load(ix + i), V::load(iy + i),
+                                                V::load(fx + i), V::load(fy + i));
+            V::store(total + i, V::add(V::load(total + i), V::mul(n, amp)));
+        }
+    }
+#endif
+
+    // adds one octave to total for every point of the chunk, with the
+    // fastest kernel and the hash of this noise
+    void octave(const float *px, const float *py, float *total,
+                unsigned count, float frequency, float amplitude) const
+    {
+        if(hash == PERMUTATION)
+            octaveWith<PermutationHash>(px, py, total, count, frequency, amplitude);
+        else
+            octaveWith<PolynomialHash>(px, py, total, count, frequency, amplitude);
+    }
+
+    template<class H>
+    void octaveWith(const float *px, const float *py, float *total,
+                    unsigned count, float frequency, float amplitude) const
+    {
+#ifdef PERLIN_SIMD
+        octaveSIMD<Lanes, H>(px, py, total, count, frequency, amplitude);
+#else
+        octaveScalar<H>(px, py, total, count, frequency, amplitude);
+#endif
+    }
+
+    // octave() for points given as lattice cells and fractions
+    void octaveLattice(const int *ix, const int *iy, const float *fx, const float *fy,
+                       float *total, unsigned count, float amplitude) const
+    {
+        if(hash == PERMUTATION)
+            octaveLatticeWith<PermutationHash>(ix, iy, fx, fy, total, count, amplitude);
+        else
+            octaveLatticeWith<PolynomialHash>(ix, iy, fx, fy, total, count, amplitude);
+    }
+
+    template<class H>
+    void octaveLatticeWith(const int *ix, const int *iy, const float *fx, const float *fy,
+                           float *total, unsigned count, float amplitude) const
+    {
+#ifdef PERLIN_SIMD
+        octaveLatticeSIMD<Lanes, H>(ix, iy, fx, fy, total, count, amplitude);
+#else
+        for(unsigned i = 0; i < count; ++i)
+            total[i] += latticeNoise<H>(ix[i], iy[i], fx[i], fy[i]) * amplitude;
+#endif
+    }
+
+    // evaluates all octaves for one chunk of at most CHUNK points;
+    // px, py and total must have room for CHUNK values
+    void getChunk(const float *px, const float *py, float *total, unsigned count) const
+    {
+        float frequency = 0.05f, amplitude = 1.0f, scale = 0.0f;
+        for(unsigned i = 0; i < CHUNK; ++i)
+            total[i] = 0.0f;
+        for(unsigned o = 0; o < octaves; ++o)
+        {
+            octave(px, py, total, count, frequency, amplitude);
+            scale += amplitude;
+            frequency *= 2.0f;
+            amplitude *= 0.5f;
+        }
+        for(unsigned i = 0; i < count; ++i)
+            total[i] /= scale;
+    }
+
+    // splits a lattice coordinate into its cell, following fastFloor(),
+    // and the fraction inside the cell; only the low 32 bits of the cell
+    // reach the hashes, so int cells hash like long ones
+    static void split(double lattice, int &cell, float &fraction)
+    {
+        int64_t integer = lattice > 0 ? (int64_t) lattice : (int64_t) lattice - 1;
+        cell = (int) integer;
+        fraction = (float) (lattice - integer);
+    }
+
+    // getChunk() for the row of count points starting at lattice point
+    // (x, y), with lattice coordinates computed in double
+    void getChunkFar(int64_t x, int64_t y, unsigned count, float scale, float *total) const
+    {
+#ifdef PERLIN_SIMD
+        alignas(32) int ix[CHUNK], iy[CHUNK];
+        alignas(32) float fx[CHUNK], fy[CHUNK];
+#else
+        int ix[CHUNK], iy[CHUNK];
+        float fx[CHUNK], fy[CHUNK];
+#endif
+        float frequency = 0.05f, amplitude = 1.0f, sum = 0.0f;
+        for(unsigned i = 0; i < CHUNK; ++i)
+        {
+            total[i] = 0.0f;
+            ix[i] = iy[i] = 0;
+            fx[i] = fy[i] = 0.0f;
+        }
+        for(unsigned o = 0; o < octaves; ++o)
+        {
+            double step = (double) scale * frequency;
+            split(y * step, iy[0], fy[0]);
+            for(unsigned i = 0; i < count; ++i)
+            {
+                split((x + (int64_t) i) * step, ix[i], fx[i]);
+                iy[i] = iy[0];
+                fy[i] = fy[0];
+            }
+            octaveLattice(ix, iy, fx, fy, total, count, amplitude);
+            sum += amplitude;
+            frequency *= 2.0f;
+            amplitude *= 0.5f;
+        }
+        for(unsigned i = 0; i < count; ++i)
+            total[i] /= sum;
+    }
+public:
+    static const unsigned MAX_OCTAVES;
+
+    PerlinNoise2D() : octaves(1), hash(POLYNOMIAL)
+    {
+        srand(time(NULL));
+        seed = rand();
+    }
+
+    PerlinNoise2D(unsigned _octaves) : octaves(_octaves), hash(POLYNOMIAL)
+    {
+        srand(time(NULL));
+        seed = rand();
+        //seed = 17811;
+        //seed = 27728;
+        //seed = 3977;
+    }
+
+    PerlinNoise2D(unsigned _octaves, unsigned long _seed, HASH _hash = POLYNOMIAL) :
+        octaves(_octaves), seed(_seed), hash(_hash)
+    {
+        if(hash == PERMUTATION)
+            buildTables();
+    }
+
+    float get(float x, float y) const
+    {
+        float frequency = 0.05f, amplitude = 1.0f, scale = 0.0f, total = 0.0f;
+        for(unsigned i = 0; i < octaves; ++i)
+        {
+            total += (hash == PERMUTATION ?
+                      interpolatedNoise<PermutationHash>(x * frequency, y * frequency) :
+                      interpolatedNoise<PolynomialHash>(x * frequency, y * frequency)) * amplitude;
+            scale += amplitude;
+            frequency *= 2.0f;
+            amplitude *= 0.5f;
+        }
+        return total / scale;
+    }
+
+    // out[i] = get((x + i * step) * scale, y * scale) for i in [0, count)
+    void getRow(float *out, unsigned count, long x, long y, float scale, long step = 1) const
+    {
+#ifdef PERLIN_SIMD
+        alignas(32) float px[CHUNK], py[CHUNK], total[CHUNK];
+#else
+        float px[CHUNK], py[CHUNK], total[CHUNK];
+#endif
+        float sy = y * scale;
+        for(unsigned i = 0; i < CHUNK; ++i)
+        {
+            px[i] = 0.0f;
+            py[i] = sy;
+        }
+        for(unsigned start = 0; start < count; start += CHUNK)
+        {
+            unsigned n = count - start < CHUNK ? count - start : CHUNK;
+            for(unsigned i = 0; i < n; ++i)
+                px[i] = (x + (long) (start + i) * step) * scale;
+            getChunk(px, py, total, n);
+            for(unsigned i = 0; i < n; ++i)
+                out[start + i] = total[i];
+        }
+    }
+
+    // out[i] = get(px[i], py[i]) for i in [0, count)
+    void getPoints(const float *px, const float *py, float *out, unsigned count) const
+    {
+#ifdef PERLIN_SIMD
+        alignas(32) float x[CHUNK], y[CHUNK], total[CHUNK];
+#else
+        float x[CHUNK], y[CHUNK], total[CHUNK];
+#endif
+        for(unsigned i = 0; i < CHUNK; ++i)
+            x[i] = y[i] = 0.0f;
+        for(unsigned start = 0; start < count; start += CHUNK)
+        {
+            unsigned n = count - start < CHUNK ? count - start : CHUNK;
+            for(unsigned i = 0; i < n; ++i)
+            {
+                x[i] = px[start + i];
+                y[i] = py[start + i];
+            }
+            getChunk(x, y, total, n);
+            for(unsigned i = 0; i < n; ++i)
+                out[start + i] = total[i];
+        }
+    }
+
+    // the running octave sums behind getRow(out, count, x, y, scale, step)
+    // before the division by getScale(): sums[o] receives octaves 0 to o
+    // for o from first to getOctaves() - 1, continuing from sums[first - 1]
+    // when first is not 0; rows of sums are count floats long
+    void getOctaveSums(float *const *sums, unsigned first, unsigned count,
+                       long x, long y, float scale, long step = 1) const
+    {
+#ifdef PERLIN_SIMD
+        alignas(32) float px[CHUNK], py[CHUNK], total[CHUNK];
+#else
+        float px[CHUNK], py[CHUNK], total[CHUNK];
+#endif
+        float firstFrequency = 0.05f, firstAmplitude = 1.0f, sy = y * scale;
+        for(unsigned o = 0; o < first; ++o)
+        {
+            firstFrequency *= 2.0f;
+            firstAmplitude *= 0.5f;
+        }
+        for(unsigned i = 0; i < CHUNK; ++i)
+        {
+            px[i] = total[i] = 0.0f;
+            py[i] = sy;
+        }
+        for(unsigned start = 0; start < count; start += CHUNK)
+        {
+            unsigned n = count - start < CHUNK ? count - start : CHUNK;
+            float frequency = firstFrequency, amplitude = firstAmplitude;
+            for(unsigned i = 0; i < n; ++i)
+            {
+                px[i] = (x + (long) (start + i) * step) * scale;
+                total[i] = first ? sums[first - 1][start + i] : 0.0f;
+            }
+            for(unsigned o = first; o < octaves; ++o)
+            {
+                octave(px, py, total, n, frequency, amplitude);
+                for(unsigned i = 0; i < n; ++i)
+                    sums[o][start + i] = total[i];
+                frequency *= 2.0f;
+                amplitude *= 0.5f;
+            }
+        }
+    }
+
+    // sum of the amplitudes of all octaves, which get() divides by
+    float getScale() const
+    {
+        float amplitude = 1.0f, scale = 0.0f;
+        for(unsigned o = 0; o < octaves; ++o)
+        {
+            scale += amplitude;
+            amplitude *= 0.5f;
+        }
+        return scale;
+    }
+
+    // same field as getRow(), but lattice positions are computed in double
+    // instead of float, so the detail does not wash out far from the
+    // origin; values can differ from getRow() in the last bits
+    void getRowFar(float *out, unsigned count, int64_t x, int64_t y, float scale) const
+    {
+#ifdef PERLIN_SIMD
+        alignas(32) float total[CHUNK];
+#else
+        float total[CHUNK];
+#endif
+        for(unsigned start = 0; start < count; start += CHUNK)
+        {
+            unsigned n = count - start < CHUNK ? count - start : CHUNK;
+            getChunkFar(x + (int64_t) start, y, n, scale, total);
+            for(unsigned i = 0; i < n; ++i)
+                out[start + i] = total[i];
+        }
+    }
+
+    // fills a width x height block of samples starting at lattice point
+    // (x, y); rows of out are stride floats apart
+    void getBlock(float *out, unsigned width, unsigned height, size_t stride,
+                  long x, long y, float scale) const
+    {
+        for(unsigned j = 0; j < height; ++j)
+            getRow(out + j * stride, width, x, y + (long) j, scale);
+    }
+
+    void setOctaves(float _octaves)
+    {
+        octaves = _octaves;
+        if(_octaves < 1)
+            octaves = 1;
+        else if(_octaves > MAX_OCTAVES)
+            octaves = MAX_OCTAVES;
+    }
+
+    unsigned getOctaves() const
+    {
+        return octaves;
+    }
+
+    unsigned long getSeed() const
+    {
+        return seed;
+    }
+
+    HASH getHash() const
+    {
+        return hash;
+    }
+};
+
+#endif // PERLINNOISE2D_H
@@ -0,0 +1,113 @@
+#ifndef POISSONDISK_H
+#define POISSONDISK_H
+
+#include <stdint.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include "Random.h"
+
+// Bridson's algorithm: random points at least spacing apart that fill a
+// rectangle until no further point fits. A grid of cells spacing / sqrt(2)
+// wide holds at most one point each, so a candidate only has to be checked
+// against the points of the 5 x 5 cells around its own
+class PoissonDisk
+{
+public:
+    struct Point
+    {
+        float x, y;
+    };
+
+    // candidates tried around a point before it stops spawning new ones
+    unsigned attempts = 30;
+
+    // points in [0, width) x [0, height), in the order they were placed;
+    // the same arguments give the same points
+    const std::vector<Point> &sample(float width, float height, float spacing, uint64_t seed)
+    {
+        points.clear();
+        active.clear();
+        if(width <= 0.0f || height <= 0.0f || spacing <= 0.0f)
+            return points;
+        cellSize = spacing / sqrtf(2.0f);
+        columns = (unsigned) ceilf(width / cellSize);
+        rows = (unsigned) ceilf(height / cellSize);
+        cells.assign((size_t) columns * rows, 0);
+        uint64_t state = seed;
+        // two statements, arguments are evaluated in any order
+        float firstX = nextFloat(state) * width;
+        add(firstX, nextFloat(state) * height);
+        const float minSquared = spacing * spacing;
+        while(!active.empty())
+        {
+            unsigned slot = nextRandom(state) % active.size();
+            Point around = points[active[slot]];
+            bool placed = false;
+            for(unsigned i = 0; i < attempts && !placed; ++i)
+            {
+                // uniform in the ring from spacing to twice the spacing
+                float angle = nextFloat(state) * 6.2831853f;
+                float distance = spacing * sqrtf(1.0f + 3.0f * nextFloat(state));
+                float x = around.x + distance * cosf(angle), y = around.y + distance * sinf(angle);
+                if(x < 0.0f || y < 0.0f || x >= width || y >= height)
+                    continue;
+                unsigned cx = std::min((unsigned) (x / cellSize), columns - 1);
+                unsigned cy = std::min((unsigned) (y / cellSize), rows - 1);
+                bool free = true;
+                for(unsigned ny = cy > 2 ? cy - 2 : 0; free && ny <= std::min(cy + 2, rows - 1); ++ny)
+                    for(unsigned nx = cx > 2 ? cx - 2 : 0; nx <= std::min(cx + 2, columns - 1); ++nx)
+                    {
+                        // the corners of the 5 x 5 cells are too far away
+                        if((ny == cy - 2 || ny == cy + 2) && (nx == cx - 2 || nx == cx + 2))
+                            continue;
+                        uint32_t other = cells[(size_t) ny * columns + nx];
+                        if(other-- == 0)
+                            continue;
+                        float dx = points[other].x - x, dy = points[other].y - y;
+                        if(dx * dx + dy * dy < minSquared)
+                        {
+                            free = false;
+                            break;
+                        }
+                    }
+                if(free)
+                {
+                    add(x, y);
+                    placed = true;
+                }
+            }
+            if(!placed)
+            {
+                active[slot] = active.back();
+                active.pop_back();
+            }
+        }
+        return points;
+    }
+
+    const std::vector<Point> &getPoints() const
+    {
+        return points;
+    }
+private:
+    float cellSize = 1.0f;
+    unsigned columns = 0, rows = 0;
+    // one more than the point in every cell, 0 when there is none
+    std::vector<uint32_t> cells;
+    std::vector<Point> points;
+    // points that may still spawn new ones
+    std::vector<uint32_t> active;
+
+    void add(float x, float y)
+    {
+        unsigned cx = std::min((unsigned) (x / cellSize), columns - 1);
+        unsigned cy = std::min((unsigned) (y / cellSize), rows - 1);
+        cells[(size_t) cy * columns + cx] = points.size() + 1;
+        active.push_back(points.size());
+        Point point = {x, y};
+        points.push_back(point);
+    }
+};
+
+#endif // POISSONDISK_H
@@ -0,0 +1,22 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <stdint.h>
+
+// splitmix64: the next of a sequence of 64 bit values that depends only on
+// the initial state, so results do not depend on the platform's rand()
+inline uint64_t nextRandom(uint64_t &state)
+{
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// uniform in [0, 1)
+inline float nextFloat(uint64_t &state)
+{
+    return (nextRandom(state) >> 40) * (1.0f / (1 << 24));
+}
+
+#endif // RANDOM_H
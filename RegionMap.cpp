@@ -0,0 +1,213 @@
+#include "RegionMap.h"
+
+const unsigned RegionMap::NO_REGION = ~0u;
+const unsigned RegionMap::BUCKET = 16;
+
+void RegionMap::build(const World &world)
+{
+    width = world.getWidth();
+    height = world.getHeight();
+    label(world.tiles);
+    connect();
+    groupLand();
+    index(world.tiles);
+}
+
+void RegionMap::label(const Grid<World::BIOME> &tiles)
+{
+    labels.resize((size_t) width * height);
+    regions.clear();
+    std::fill(largest, largest + BIOMES, NO_REGION);
+    for(unsigned y = 0; y < height; ++y)
+    {
+        const World::BIOME *row = tiles[y];
+        const World::BIOME *above = y > 0 ? tiles[y - 1] : nullptr;
+        for(unsigned x = 0; x < width; ++x)
+        {
+            size_t index = (size_t) y * width + x;
+            bool left = x > 0 && row[x - 1] == row[x];
+            bool up = above && above[x] == row[x];
+            // a tile joins the tree of its left or upper neighbour; the two
+            // are only united when the tile above and left of it does not
+            // connect them already
+            if(left)
+            {
+                labels[index] = labels[index - 1];
+                if(up && above[x - 1] != row[x])
+                    unite(index - width, index);
+            }
+            else if(up)
+                labels[index] = labels[index - width];
+            else
+                labels[index] = (uint32_t) index;
+        }
+    }
+    // turn parent links into region ids; parents come first in scan
+    // order, so they already hold their region id when it is needed
+    for(unsigned y = 0; y < height; ++y)
+        for(unsigned x = 0; x < width; ++x)
+        {
+            size_t index = (size_t) y * width + x;
+            if(labels[index] == index)
+            {
+                labels[index] = regions.size();
+                Region region = {tiles[y][x], 0, x, y, x, y, false, NO_REGION};
+                regions.push_back(region);
+            }
+            else
+                labels[index] = labels[labels[index]];
+            Region &region = regions[labels[index]];
+            ++region.area;
+            region.minX = std::min(region.minX, x);
+            region.maxX = std::max(region.maxX, x);
+            region.maxY = y;
+            if(x == 0 || y == 0 || x == width - 1 || y == height - 1)
+                region.touchesEdge = true;
+        }
+    for(unsigned id = 0; id < regions.size(); ++id)
+    {
+        World::BIOME biome = regions[id].biome;
+        if(largest[biome] == NO_REGION || regions[largest[biome]].area < regions[id].area)
+            largest[biome] = id;
+    }
+}
+
+uint32_t RegionMap::findRoot(uint32_t i)
+{
+    while(labels[i] != i)
+    {
+        labels[i] = labels[labels[i]];
+        i = labels[i];
+    }
+    return i;
+}
+
+void RegionMap::unite(uint32_t first, uint32_t second)
+{
+    uint32_t i = findRoot(first);
+    uint32_t j = findRoot(second);
+    if(i < j)
+        labels[j] = i;
+    else if(j < i)
+        labels[i] = j;
+}
+
+void RegionMap::connect()
+{
+    pairs.clear();
+    auto add = [&](uint32_t first, uint32_t second)
+    {
+        if(first == second)
+            return;
+        uint64_t pair = first < second ? (uint64_t) first << 32 | second :
+                                         (uint64_t) second << 32 | first;
+        // long shared edges repeat the same pair many times in a row
+        if(pairs.empty() || pairs.back() != pair)
+            pairs.push_back(pair);
+    };
+    for(unsigned y = 0; y < height; ++y)
+    {
+        const uint32_t *row = &labels[(size_t) y * width];
+        for(unsigned x = 0; x + 1 < width; ++x)
+            add(row[x], row[x + 1]);
+        if(y + 1 < height)
+            for(unsigned x = 0; x < width; ++x)
+                add(row[x], row[x + width]);
+    }
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+    neighbourStart.assign(regions.size() + 1, 0);
+    for(auto pair : pairs)
+    {
+        ++neighbourStart[(pair >> 32) + 1];
+        ++neighbourStart[(uint32_t) pair + 1];
+    }
+    for(size_t i = 1; i < neighbourStart.size(); ++i)
+        neighbourStart[i] += neighbourStart[i - 1];
+    neighbours.resize(neighbourStart.back());
+    cursor.assign(neighbourStart.begin(), neighbourStart.end() - 1);
+    for(auto pair : pairs)
+    {
+        uint32_t first = pair >> 32, second = (uint32_t) pair;
+        neighbours[cursor[first]++] = second;
+        neighbours[cursor[second]++] = first;
+    }
+}
+
+void RegionMap::groupLand()
+{
+    landmassAreas.clear();
+    largestLandmass = NO_REGION;
+    for(unsigned i = 0; i < regions.size(); ++i)
+    {
+        if(isWater(regions[i].biome) || regions[i].landmass != NO_REGION)
+            continue;
+        unsigned landmass = landmassAreas.size();
+        unsigned long area = 0;
+        regions[i].landmass = landmass;
+        stack.push_back(i);
+        while(!stack.empty())
+        {
+            uint32_t region = stack.back();
+            stack.pop_back();
+            area += regions[region].area;
+            for(uint32_t j = neighbourStart[region]; j < neighbourStart[region + 1]; ++j)
+            {
+                Region &next = regions[neighbours[j]];
+                if(!isWater(next.biome) && next.landmass == NO_REGION)
+                {
+                    next.landmass = landmass;
+                    stack.push_back(neighbours[j]);
+                }
+            }
+        }
+        landmassAreas.push_back(area);
+        if(largestLandmass == NO_REGION || landmassAreas[largestLandmass] < area)
+            largestLandmass = landmass;
+    }
+}
+
+void RegionMap::index(const Grid<World::BIOME> &tiles)
+{
+    bucketColumns = (width + BUCKET - 1) / BUCKET;
+    bucketRows = (height + BUCKET - 1) / BUCKET;
+    bucketCount = bucketColumns * bucketRows;
+    size_t keys = (size_t) BIOMES * bucketCount;
+    auto key = [&](unsigned x, unsigned y)
+    {
+        return tiles[y][x] * (size_t) bucketCount + (size_t) (y / BUCKET) * bucketColumns +
+               x / BUCKET;
+    };
+    tileStart.assign(keys + 1, 0);
+    for(unsigned y = 0; y < height; ++y)
+        for(unsigned x = 0; x < width; ++x)
+            ++tileStart[key(x, y) + 1];
+    for(size_t k = 1; k <= keys; ++k)
+        tileStart[k] += tileStart[k - 1];
+    bucketTiles.resize((size_t) width * height);
+    cursor.assign(tileStart.begin(), tileStart.end() - 1);
+    for(unsigned y = 0; y < height; ++y)
+        for(unsigned x = 0; x < width; ++x)
+            bucketTiles[cursor[key(x, y)]++] = y * width + x;
+    regionStart.assign(keys + 1, 0);
+    bucketRegions.clear();
+    // the key that last listed every region, so a region is listed once
+    // per key without sorting all the tiles of the key
+    std::vector<uint32_t> &listed = cursor;
+    listed.assign(regions.size(), ~0u);
+    for(size_t k = 0; k < keys; ++k)
+    {
+        size_t begin = bucketRegions.size();
+        for(uint32_t i = tileStart[k]; i < tileStart[k + 1]; ++i)
+        {
+            uint32_t region = labels[bucketTiles[i]];
+            if(listed[region] != k)
+            {
+                listed[region] = k;
+                bucketRegions.push_back(region);
+            }
+        }
+        std::sort(bucketRegions.begin() + begin, bucketRegions.end());
+        regionStart[k + 1] = bucketRegions.size();
+    }
+}
@@ -0,0 +1,259 @@
+#ifndef REGIONMAP_H
+#define REGIONMAP_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+#include "World.h"
+
+// the 4-connected regions of equal biome of a generated world, the
+// regions they touch, and an index of the tiles of every biome in square
+// buckets for nearest tile and rectangle queries; all queries are const
+// and may run on any number of threads at once
+class RegionMap
+{
+public:
+    static const unsigned NO_REGION;
+    // tiles per side of a bucket of the index
+    static const unsigned BUCKET;
+
+    struct Region
+    {
+        World::BIOME biome;
+        unsigned long area;
+        // bounding box, inclusive
+        unsigned minX, minY, maxX, maxY;
+        bool touchesEdge;
+        // connected land the region belongs to, NO_REGION for water;
+        // rivers count as land, so they do not split it
+        unsigned landmass;
+    };
+
+    // labels the tiles of world, reusing the buffers of the last build
+    void build(const World &world);
+
+    unsigned getWidth() const
+    {
+        return width;
+    }
+
+    unsigned getHeight() const
+    {
+        return height;
+    }
+
+    unsigned getRegionAt(unsigned x, unsigned y) const
+    {
+        return labels[(size_t) y * width + x];
+    }
+
+    unsigned getRegionCount() const
+    {
+        return regions.size();
+    }
+
+    const Region &getRegion(unsigned id) const
+    {
+        return regions[id];
+    }
+
+    // ids of the regions sharing an edge with region id, ascending
+    const uint32_t *getNeighbours(unsigned id) const
+    {
+        return neighbours.data() + neighbourStart[id];
+    }
+
+    unsigned getNeighbourCount(unsigned id) const
+    {
+        return neighbourStart[id + 1] - neighbourStart[id];
+    }
+
+    // largest region of biome, NO_REGION when there is none
+    unsigned getLargest(World::BIOME biome) const
+    {
+        return largest[biome];
+    }
+
+    unsigned getLandmassCount() const
+    {
+        return landmassAreas.size();
+    }
+
+    unsigned long getLandmassArea(unsigned landmass) const
+    {
+        return landmassAreas[landmass];
+    }
+
+    // landmass with the most tiles, NO_REGION when there is no land
+    unsigned getLargestLandmass() const
+    {
+        return largestLandmass;
+    }
+
+    // finds the tile of biome closest to (x, y) by euclidean distance;
+    // false when the world has no tile of biome
+    bool findNearest(World::BIOME biome, unsigned x, unsigned y,
+                     unsigned &foundX, unsigned &foundY) const
+    {
+        size_t first = (size_t) biome * bucketCount;
+        if(tileStart[first] == tileStart[first + bucketCount])
+            return false;
+        long bx = x / BUCKET, by = y / BUCKET;
+        long columns = bucketColumns, rows = bucketRows;
+        unsigned long long best = ~0ull;
+        for(long r = 0; ; ++r)
+        {
+            // every tile r buckets away is at least this far along one axis
+            unsigned long long bound = r > 0 ? (r - 1) * BUCKET + 1 : 0;
+            if(bound * bound >= best)
+                break;
+            if(bx - r < 0 && by - r < 0 && bx + r >= columns && by + r >= rows)
+                break;
+            auto scan = [&](long cx, long cy)
+            {
+                if(cx < 0 || cx >= columns)
+                    return;
+                size_t key = first + cy * columns + cx;
+                for(uint32_t i = tileStart[key]; i < tileStart[key + 1]; ++i)
+                {
+                    unsigned tx = bucketTiles[i] % width, ty = bucketTiles[i] / width;
+                    long long dx = (long long) tx - x, dy = (long long) ty - y;
+                    unsigned long long distance = dx * dx + dy * dy;
+                    if(distance < best)
+                    {
+                        best = distance;
+                        foundX = tx;
+                        foundY = ty;
+                    }
+                }
+            };
+            for(long cy = std::max(by - r, 0L); cy <= std::min(by + r, rows - 1); ++cy)
+            {
+                // the top and bottom row of the ring are whole, the
+                // others only have their two ends
+                if(cy == by - r || cy == by + r)
+                    for(long cx = bx - r; cx <= bx + r; ++cx)
+                        scan(cx, cy);
+                else
+                {
+                    scan(bx - r, cy);
+                    scan(bx + r, cy);
+                }
+            }
+        }
+        return true;
+    }
+
+    // stores the ids of the regions of biome with a tile in
+    // [x0, x1) x [y0, y1) in out, ascending. Buckets inside the rectangle
+    // or of biome only are answered from their region lists; the tiles of
+    // the other buckets are only visited when a region of theirs is not
+    // already found and its bounding box neither lies inside the
+    // rectangle nor misses it
+    void findRegions(World::BIOME biome, unsigned x0, unsigned y0, unsigned x1, unsigned y1,
+                     std::vector<unsigned> &out) const
+    {
+        out.clear();
+        x1 = std::min(x1, width);
+        y1 = std::min(y1, height);
+        if(x0 >= x1 || y0 >= y1)
+            return;
+        size_t first = (size_t) biome * bucketCount;
+        unsigned cx0 = x0 / BUCKET, cy0 = y0 / BUCKET;
+        unsigned cx1 = (x1 - 1) / BUCKET, cy1 = (y1 - 1) / BUCKET;
+        auto isWhole = [&](unsigned cx, unsigned cy, size_t key)
+        {
+            unsigned left = cx * BUCKET, top = cy * BUCKET;
+            unsigned right = std::min(left + BUCKET, width);
+            unsigned bottom = std::min(top + BUCKET, height);
+            // a bucket of one biome only is a single region
+            return tileStart[key + 1] - tileStart[key] == (right - left) * (bottom - top) ||
+                   (left >= x0 && right <= x1 && top >= y0 && bottom <= y1);
+        };
+        for(unsigned cy = cy0; cy <= cy1; ++cy)
+            for(unsigned cx = cx0; cx <= cx1; ++cx)
+            {
+                size_t key = first + (size_t) cy * bucketColumns + cx;
+                if(isWhole(cx, cy, key))
+                    out.insert(out.end(), bucketRegions.begin() + regionStart[key],
+                               bucketRegions.begin() + regionStart[key + 1]);
+            }
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+        size_t found = out.size();
+        for(unsigned cy = cy0; cy <= cy1; ++cy)
+            for(unsigned cx = cx0; cx <= cx1; ++cx)
+            {
+                size_t key = first + (size_t) cy * bucketColumns + cx;
+                if(isWhole(cx, cy, key))
+                    continue;
+                bool visit = false;
+                for(uint32_t i = regionStart[key]; i < regionStart[key + 1]; ++i)
+                {
+                    unsigned id = bucketRegions[i];
+                    const Region &region = regions[id];
+                    if(std::binary_search(out.begin(), out.begin() + found, id) ||
+                       region.maxX < x0 || region.minX >= x1 ||
+                       region.maxY < y0 || region.minY >= y1)
+                        continue;
+                    if(region.minX >= x0 && region.maxX < x1 &&
+                       region.minY >= y0 && region.maxY < y1)
+                        out.push_back(id);
+                    else
+                        visit = true;
+                }
+                if(!visit)
+                    continue;
+                for(uint32_t i = tileStart[key]; i < tileStart[key + 1]; ++i)
+                {
+                    unsigned tx = bucketTiles[i] % width, ty = bucketTiles[i] / width;
+                    if(tx >= x0 && tx < x1 && ty >= y0 && ty < y1)
+                        out.push_back(labels[bucketTiles[i]]);
+                }
+            }
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+    }
+private:
+    static const unsigned BIOMES = World::RIVER + 1;
+
+    unsigned width = 0, height = 0;
+    std::vector<uint32_t> labels;
+    std::vector<Region> regions;
+    // neighbours of region i are neighbours[neighbourStart[i]] up to
+    // neighbourStart[i + 1]
+    std::vector<uint32_t> neighbourStart, neighbours;
+    unsigned largest[BIOMES];
+    std::vector<unsigned long> landmassAreas;
+    unsigned largestLandmass = NO_REGION;
+    // the index has a key for every biome and bucket, biome major; key k
+    // owns the tile indices bucketTiles[tileStart[k]] up to
+    // tileStart[k + 1], in scan order, and its distinct regions in
+    // bucketRegions the same way
+    unsigned bucketColumns = 0, bucketRows = 0, bucketCount = 0;
+    std::vector<uint32_t> tileStart, bucketTiles, regionStart, bucketRegions;
+    std::vector<uint32_t> stack, cursor;
+    std::vector<uint64_t> pairs;
+
+    static bool isWater(World::BIOME biome)
+    {
+        return biome == World::OCEAN || biome == World::COAST || biome == World::LAKE;
+    }
+
+    // labels every region with union find, numbering the regions in the
+    // scan order of their first tile
+    void label(const Grid<World::BIOME> &tiles);
+    // finds the root of a region; every parent has a lower index than its
+    // children, so roots are the first tile of their region in scan order
+    uint32_t findRoot(uint32_t i);
+    void unite(uint32_t first, uint32_t second);
+    // collects every pair of touching regions once; sorted pairs give
+    // every region its neighbours in ascending order
+    void connect();
+    // numbers the connected groups of land regions in region order
+    void groupLand();
+    // sorts the tiles into their biome and bucket by counting
+    void index(const Grid<World::BIOME> &tiles);
+};
+
+#endif // REGIONMAP_H
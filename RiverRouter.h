@@ -0,0 +1,127 @@
+#ifndef RIVERROUTER_H
+#define RIVERROUTER_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+// best-first search over a heightmap that always expands the lowest open
+// tile, used to route a river from its source down to water; heights are
+// quantized into buckets, tiles inside one bucket go last in first out
+class RiverRouter
+{
+private:
+    // direction back to the tile that opened a tile
+    enum DIRECTION : uint8_t
+    {
+        TOP,
+        BOTTOM,
+        LEFT,
+        RIGHT
+    };
+
+    // heights are clamped to [LOW, HIGH) before bucketing
+    static constexpr float LOW = -1.0f, HIGH = 2.0f;
+    static const unsigned BUCKETS = 1 << 14;
+
+    unsigned width, height;
+    // a tile is open in the current search when its stamp equals
+    // generation, so nothing has to be cleared between searches
+    std::vector<uint32_t> stamps;
+    std::vector<uint8_t> directions;
+    uint32_t generation;
+    std::vector<std::vector<uint32_t>> buckets;
+    // buckets outside [lowest, highest] are empty
+    unsigned lowest, highest;
+
+    unsigned bucket(float h) const
+    {
+        float key = (h - LOW) * (BUCKETS / (HIGH - LOW));
+        if(!(key > 0.0f))
+            return 0;
+        if(key >= BUCKETS - 1)
+            return BUCKETS - 1;
+        return (unsigned) key;
+    }
+
+    void open(const float *heights, uint32_t index, DIRECTION direction)
+    {
+        unsigned b = bucket(heights[index]);
+        stamps[index] = generation;
+        directions[index] = direction;
+        buckets[b].push_back(index);
+        lowest = std::min(lowest, b);
+        highest = std::max(highest, b);
+        ++pushed;
+    }
+public:
+    static const uint32_t NO_TARGET = ~(uint32_t) 0;
+
+    // counters of the last search
+    unsigned long pushed, popped;
+
+    RiverRouter(unsigned _width, unsigned _height) :
+        width(_width), height(_height), stamps((size_t) _width * _height, 0),
+        directions((size_t) _width * _height), generation(0), buckets(BUCKETS),
+        lowest(BUCKETS), highest(0), pushed(0), popped(0) {}
+
+    // searches from source until the lowest open tile satisfies
+    // isTarget(index) and returns that tile, or NO_TARGET when every
+    // reachable tile was expanded without finding one
+    template<class IsTarget>
+    uint32_t search(const float *heights, uint32_t source, IsTarget isTarget)
+    {
+        for(unsigned b = lowest; b <= highest && b < BUCKETS; ++b)
+            buckets[b].clear();
+        lowest = BUCKETS;
+        highest = 0;
+        pushed = popped = 0;
+        if(++generation == 0)
+        {
+            std::fill(stamps.begin(), stamps.end(), 0);
+            generation = 1;
+        }
+        open(heights, source, TOP);
+        while(true)
+        {
+            while(lowest <= highest && buckets[lowest].empty())
+                ++lowest;
+            if(lowest > highest)
+                return NO_TARGET;
+            uint32_t index = buckets[lowest].back();
+            if(isTarget(index))
+                return index;
+            buckets[lowest].pop_back();
+            ++popped;
+            unsigned x = index % width, y = index / width;
+            if(y > 0 && stamps[index - width] != generation)
+                open(heights, index - width, BOTTOM);
+            if(y < height - 1 && stamps[index + width] != generation)
+                open(heights, index + width, TOP);
+            if(x > 0 && stamps[index - 1] != generation)
+                open(heights, index - 1, RIGHT);
+            if(x < width - 1 && stamps[index + 1] != generation)
+                open(heights, index + 1, LEFT);
+        }
+    }
+
+    // whether the last search opened the tile
+    bool opened(uint32_t index) const
+    {
+        return stamps[index] == generation;
+    }
+
+    // the tile that opened index in the last search
+    uint32_t parent(uint32_t index) const
+    {
+        switch(directions[index])
+        {
+        case TOP: return index - width;
+        case BOTTOM: return index + width;
+        case LEFT: return index - 1;
+        default: return index + 1;
+        }
+    }
+};
+
+#endif // RIVERROUTER_H
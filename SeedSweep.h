@@ -0,0 +1,151 @@
+#ifndef SEEDSWEEP_H
+#define SEEDSWEEP_H
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "World.h"
+
+// what a sweep keeps of one world
+struct SweepResult
+{
+    unsigned long seed;
+    float waterFactor;
+    unsigned riverCount;
+    // connected lake regions
+    unsigned lakeCount;
+    // tiles of every biome
+    uint32_t histogram[World::RIVER + 1];
+};
+
+// generates the worlds of a range of seeds and keeps only their
+// statistics; every thread of the pool works on its own world, whose
+// buffers are reused from one seed to the next
+class SeedSweep
+{
+private:
+    // buffers of one thread
+    struct Lane
+    {
+        World world;
+        Erosion erosion;
+        BitGrid visited;
+        std::vector<uint32_t> stack;
+
+        Lane(unsigned width, unsigned height) :
+            world(width, height), visited(width, height) {}
+    };
+
+    unsigned width, height;
+    ThreadPool *pool;
+    std::vector<std::unique_ptr<Lane>> lanes;
+
+    // counts the 4-connected lake regions of the world of lane
+    unsigned countLakes(Lane &lane) const
+    {
+        const Grid<World::BIOME> &tiles = lane.world.tiles;
+        unsigned count = 0;
+        lane.visited.fill(false);
+        for(unsigned y = 0; y < height; ++y)
+            for(unsigned x = 0; x < width; ++x)
+            {
+                if(tiles[y][x] != World::LAKE || lane.visited.get(x, y))
+                    continue;
+                ++count;
+                lane.visited.set(x, y, true);
+                lane.stack.push_back(y * width + x);
+                while(!lane.stack.empty())
+                {
+                    uint32_t index = lane.stack.back();
+                    lane.stack.pop_back();
+                    unsigned tx = index % width, ty = index / width;
+                    auto visit = [&](unsigned nx, unsigned ny)
+                    {
+                        if(tiles[ny][nx] == World::LAKE && !lane.visited.get(nx, ny))
+                        {
+                            lane.visited.set(nx, ny, true);
+                            lane.stack.push_back(ny * width + nx);
+                        }
+                    };
+                    if(ty > 0)
+                        visit(tx, ty - 1);
+                    if(ty < height - 1)
+                        visit(tx, ty + 1);
+                    if(tx > 0)
+                        visit(tx - 1, ty);
+                    if(tx < width - 1)
+                        visit(tx + 1, ty);
+                }
+            }
+        return count;
+    }
+
+    void sweepSeed(Lane &lane, const WorldSettings &settings, unsigned long seed,
+                   SweepResult &result) const
+    {
+        PerlinNoise2D noise(settings.octaves, seed, settings.hash);
+        World &world = lane.world;
+        world.noise = &noise;
+        world.generate(settings.adjust);
+        world.noise = nullptr;
+        result.seed = seed;
+        result.waterFactor = world.getWaterFactor();
+        result.riverCount = world.getRiverCount();
+        for(auto &count : result.histogram)
+            count = 0;
+        for(unsigned y = 0; y < height; ++y)
+        {
+            const World::BIOME *row = world.tiles[y];
+            for(unsigned x = 0; x < width; ++x)
+                ++result.histogram[row[x]];
+        }
+        result.lakeCount = countLakes(lane);
+    }
+public:
+    SeedSweep(unsigned _width, unsigned _height, ThreadPool *_pool = nullptr) :
+        width(_width), height(_height), pool(_pool) {}
+
+    // generates the worlds of seeds [first, first + count) with settings,
+    // whose seed is ignored, and returns their results in seed order
+    std::vector<SweepResult> run(unsigned long first, unsigned count,
+                                 const WorldSettings &settings)
+    {
+        std::vector<SweepResult> results(count);
+        unsigned laneCount = pool ? std::min(pool->size(), count) : 1;
+        while(lanes.size() < laneCount)
+        {
+            lanes.emplace_back(new Lane(width, height));
+            World &world = lanes.back()->world;
+            // a world per thread, so no world uses the pool itself, and
+            // with a new seed every time there is nothing to cache
+            world.pool = nullptr;
+            world.cacheFields = false;
+        }
+        for(unsigned i = 0; i < laneCount; ++i)
+        {
+            World &world = lanes[i]->world;
+            world.a = settings.a;
+            world.b = settings.b;
+            world.c = settings.c;
+            world.warp = settings.warp;
+            world.maxRivers = settings.maxRivers;
+            world.biomes = settings.biomes;
+            world.terrain = settings.terrain;
+            world.erosion = settings.erode ? &lanes[i]->erosion : nullptr;
+        }
+        std::atomic<unsigned> next(0);
+        auto job = [&](unsigned lane)
+        {
+            for(unsigned i = next++; i < count; i = next++)
+                sweepSeed(*lanes[lane], settings, first + i, results[i]);
+        };
+        if(laneCount > 1)
+            pool->run(laneCount, job);
+        else if(count > 0)
+            job(0);
+        return results;
+    }
+};
+
+#endif // SEEDSWEEP_H
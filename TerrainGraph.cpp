@@ -0,0 +1,377 @@
+#include "TerrainGraph.h"
+#include <math.h>
+#include <algorithm>
+#include <stdexcept>
+#include "World.h"
+
+const unsigned TerrainGraph::NO_NODE = ~0u;
+const unsigned TerrainProgram::FALLOFF_OPERAND = 1u << 31;
+const unsigned TerrainProgram::CHUNK = 256;
+
+namespace
+{
+    // the line through count points at value; NaN gives the first level
+    float evaluateCurve(const float *points, unsigned count, float value)
+    {
+        if(!(value > points[0]))
+            return points[1];
+        for(unsigned k = 1; k < count; ++k)
+            if(value < points[2 * k])
+            {
+                const float *from = points + 2 * (k - 1);
+                float t = (value - from[0]) / (from[2] - from[0]);
+                return from[1] + t * (from[3] - from[1]);
+            }
+        return points[2 * count - 1];
+    }
+
+    // the operations of the nodes that combine two values; folded
+    // constants and the loops of run() both use them, so a constant part
+    // of a graph gives what the same part gives per tile
+    float combine(TerrainGraph::OP op, float first, float second)
+    {
+        switch(op)
+        {
+        case TerrainGraph::ADD:
+            return first + second;
+        case TerrainGraph::SUBTRACT:
+            return first - second;
+        case TerrainGraph::MULTIPLY:
+            return first * second;
+        case TerrainGraph::MINIMUM:
+            return second < first ? second : first;
+        default:
+            return first < second ? second : first;
+        }
+    }
+
+    template<TerrainGraph::OP OPERATION>
+    void combineRow(const float *first, const float *second, float *out, unsigned count)
+    {
+        for(unsigned i = 0; i < count; ++i)
+            out[i] = combine(OPERATION, first[i], second[i]);
+    }
+
+    bool isBinary(TerrainGraph::OP op)
+    {
+        return op >= TerrainGraph::ADD;
+    }
+}
+
+unsigned TerrainGraph::addNode(OP op, unsigned inputs, unsigned first, unsigned second)
+{
+    if((inputs > 0 && first >= nodes.size()) || (inputs > 1 && second >= nodes.size()))
+        throw std::invalid_argument("TerrainGraph input is not a node");
+    Node node = {op, first, second, 0.0f, 0, 0, 0.0f, 0, 0};
+    nodes.push_back(node);
+    return nodes.size() - 1;
+}
+
+unsigned TerrainGraph::constant(float value)
+{
+    unsigned id = addNode(CONSTANT);
+    nodes[id].value = value;
+    return id;
+}
+
+unsigned TerrainGraph::noise(long x, long y, float scale)
+{
+    if(!isfinite(scale))
+        throw std::invalid_argument("TerrainGraph noise scale must be finite");
+    unsigned id = addNode(NOISE);
+    nodes[id].x = x;
+    nodes[id].y = y;
+    nodes[id].scale = scale;
+    return id;
+}
+
+unsigned TerrainGraph::warpedNoise(long x, long y, float scale, unsigned warpX, unsigned warpY,
+                                   float distance)
+{
+    if(!isfinite(scale) || !isfinite(distance))
+        throw std::invalid_argument("TerrainGraph noise scale and warp must be finite");
+    unsigned id = addNode(NOISE, 2, warpX, warpY);
+    nodes[id].value = distance;
+    nodes[id].x = x;
+    nodes[id].y = y;
+    nodes[id].scale = scale;
+    return id;
+}
+
+unsigned TerrainGraph::falloff(float exponent)
+{
+    if(!isfinite(exponent))
+        throw std::invalid_argument("TerrainGraph falloff exponent must be finite");
+    unsigned id = addNode(FALLOFF);
+    nodes[id].value = exponent;
+    return id;
+}
+
+unsigned TerrainGraph::remap(unsigned input)
+{
+    return addNode(REMAP, 1, input);
+}
+
+unsigned TerrainGraph::curve(unsigned input, const std::vector<float> &curvePoints)
+{
+    if(curvePoints.size() < 2 || curvePoints.size() % 2)
+        throw std::invalid_argument("TerrainGraph curve needs pairs of x and y");
+    for(size_t i = 0; i < curvePoints.size(); ++i)
+        if(!isfinite(curvePoints[i]) || (i % 2 == 0 && i > 0 && curvePoints[i] <= curvePoints[i - 2]))
+            throw std::invalid_argument("TerrainGraph curve points must be finite with x increasing");
+    unsigned id = addNode(CURVE, 1, input);
+    nodes[id].firstPoint = points.size();
+    nodes[id].pointCount = curvePoints.size() / 2;
+    points.insert(points.end(), curvePoints.begin(), curvePoints.end());
+    return id;
+}
+
+unsigned TerrainGraph::add(unsigned first, unsigned second)
+{
+    return addNode(ADD, 2, first, second);
+}
+
+unsigned TerrainGraph::subtract(unsigned first, unsigned second)
+{
+    return addNode(SUBTRACT, 2, first, second);
+}
+
+unsigned TerrainGraph::multiply(unsigned first, unsigned second)
+{
+    return addNode(MULTIPLY, 2, first, second);
+}
+
+unsigned TerrainGraph::minimum(unsigned first, unsigned second)
+{
+    return addNode(MINIMUM, 2, first, second);
+}
+
+unsigned TerrainGraph::maximum(unsigned first, unsigned second)
+{
+    return addNode(MAXIMUM, 2, first, second);
+}
+
+void TerrainGraph::setOutputs(unsigned _height, unsigned _moisture)
+{
+    if(_height >= nodes.size() || _moisture >= nodes.size())
+        throw std::invalid_argument("TerrainGraph output is not a node");
+    height = _height;
+    moisture = _moisture;
+}
+
+void TerrainProgram::compile(const TerrainGraph &graph)
+{
+    typedef TerrainGraph::Node Node;
+    const unsigned NO_NODE = TerrainGraph::NO_NODE;
+    const std::vector<Node> &nodes = graph.getNodes();
+    unsigned outputs[2] = {graph.getHeight(), graph.getMoisture()};
+    if(outputs[0] >= nodes.size() || outputs[1] >= nodes.size())
+        throw std::invalid_argument("TerrainGraph outputs are not set");
+    code.clear();
+    fields.clear();
+    falloffs.clear();
+    points = graph.getPoints();
+    constants.clear();
+    slots = 0;
+
+    // the nodes the outputs depend on; inputs come before their nodes
+    std::vector<bool> live(nodes.size(), false);
+    live[outputs[0]] = live[outputs[1]] = true;
+    for(unsigned i = nodes.size(); i-- > 0;)
+        if(live[i])
+        {
+            if(nodes[i].first != NO_NODE)
+                live[nodes[i].first] = true;
+            if(nodes[i].second != NO_NODE)
+                live[nodes[i].second] = true;
+        }
+    // values of the nodes that do not depend on a tile
+    std::vector<bool> folded(nodes.size(), false);
+    std::vector<float> values(nodes.size(), 0.0f);
+    for(unsigned i = 0; i < nodes.size(); ++i)
+    {
+        const Node &node = nodes[i];
+        if(!live[i])
+            continue;
+        if(node.op == TerrainGraph::CONSTANT)
+        {
+            folded[i] = true;
+            values[i] = node.value;
+        }
+        else if(node.op == TerrainGraph::REMAP && folded[node.first])
+        {
+            folded[i] = true;
+            values[i] = World::remap(values[node.first]);
+        }
+        else if(node.op == TerrainGraph::CURVE && folded[node.first])
+        {
+            folded[i] = true;
+            values[i] = evaluateCurve(&points[node.firstPoint], node.pointCount, values[node.first]);
+        }
+        else if(isBinary(node.op) && folded[node.first] && folded[node.second])
+        {
+            folded[i] = true;
+            values[i] = combine(node.op, values[node.first], values[node.second]);
+        }
+    }
+    // the last node that reads the value of a node, nodes.size() for the
+    // outputs; folded nodes read nothing per tile
+    std::vector<unsigned> lastUse(nodes.size(), NO_NODE);
+    lastUse[outputs[0]] = lastUse[outputs[1]] = nodes.size();
+    for(unsigned i = nodes.size(); i-- > 0;)
+        if(live[i] && !folded[i])
+        {
+            if(nodes[i].first != NO_NODE && lastUse[nodes[i].first] == NO_NODE)
+                lastUse[nodes[i].first] = i;
+            if(nodes[i].second != NO_NODE && lastUse[nodes[i].second] == NO_NODE)
+                lastUse[nodes[i].second] = i;
+        }
+
+    // a slot is free again after the last node that reads it, so chains
+    // of operations reuse the same few slots
+    std::vector<unsigned> operands(nodes.size(), 0), freeSlots;
+    std::vector<bool> permanent(nodes.size(), false);
+    for(unsigned i = 0; i < nodes.size(); ++i)
+    {
+        const Node &node = nodes[i];
+        if(lastUse[i] == NO_NODE)
+            continue;
+        if(folded[i])
+        {
+            permanent[i] = true;
+            operands[i] = slots++;
+            constants.push_back(std::make_pair(operands[i], values[i]));
+            continue;
+        }
+        if(node.op == TerrainGraph::FALLOFF)
+        {
+            unsigned f = std::find(falloffs.begin(), falloffs.end(), node.value) - falloffs.begin();
+            if(f == falloffs.size())
+                falloffs.push_back(node.value);
+            operands[i] = FALLOFF_OPERAND | f;
+            continue;
+        }
+        Instruction instruction = {node.op, 0, NO_NODE, NO_NODE, 0, 0, node.x, node.y, node.scale,
+                                   node.value};
+        if(node.first != NO_NODE)
+            instruction.first = operands[node.first];
+        if(node.second != NO_NODE)
+            instruction.second = operands[node.second];
+        if(node.op == TerrainGraph::NOISE && node.first == NO_NODE)
+        {
+            unsigned f = 0;
+            while(f < fields.size() && (fields[f].x != node.x || fields[f].y != node.y ||
+                                        fields[f].scale != node.scale))
+                ++f;
+            if(f == fields.size())
+            {
+                Field field = {node.x, node.y, node.scale};
+                fields.push_back(field);
+            }
+            instruction.index = f;
+        }
+        else if(node.op == TerrainGraph::CURVE)
+        {
+            instruction.index = node.firstPoint;
+            instruction.pointCount = node.pointCount;
+        }
+        // inputs read for the last time give their slot to the result
+        for(unsigned input : {node.first, node.second})
+            if(input != NO_NODE && lastUse[input] == i && !permanent[input] &&
+               !(operands[input] & FALLOFF_OPERAND) &&
+               std::find(freeSlots.begin(), freeSlots.end(), operands[input]) == freeSlots.end())
+                freeSlots.push_back(operands[input]);
+        if(freeSlots.empty())
+            instruction.out = slots++;
+        else
+        {
+            instruction.out = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        operands[i] = instruction.out;
+        code.push_back(instruction);
+    }
+    heightOperand = operands[outputs[0]];
+    moistureOperand = operands[outputs[1]];
+}
+
+size_t TerrainProgram::getScratchSize() const
+{
+    return (size_t) slots * CHUNK;
+}
+
+void TerrainProgram::run(const Row &row, float *height, float *moisture) const
+{
+#ifdef PERLIN_SIMD
+    alignas(32) float px[CHUNK], py[CHUNK];
+#else
+    float px[CHUNK], py[CHUNK];
+#endif
+    for(auto &constant : constants)
+        std::fill(row.scratch + (size_t) constant.first * CHUNK,
+                  row.scratch + (size_t) (constant.first + 1) * CHUNK, constant.second);
+    for(unsigned start = 0; start < row.count; start += CHUNK)
+    {
+        unsigned n = std::min(CHUNK, row.count - start);
+        for(auto &instruction : code)
+        {
+            float *out = row.scratch + (size_t) instruction.out * CHUNK;
+            const float *first = instruction.first == TerrainGraph::NO_NODE ? nullptr :
+                                 read(row, instruction.first, start);
+            const float *second = instruction.second == TerrainGraph::NO_NODE ? nullptr :
+                                  read(row, instruction.second, start);
+            switch(instruction.op)
+            {
+            case TerrainGraph::NOISE:
+                if(first)
+                {
+                    // lattice points of the full world moved by the warp
+                    float distance = instruction.distance, scale = instruction.scale;
+                    float y = (float) (instruction.y + row.y);
+                    for(unsigned i = 0; i < n; ++i)
+                    {
+                        float x = (float) (instruction.x + (long) (start + i) * row.step);
+                        px[i] = (x + distance * first[i]) * scale;
+                        py[i] = (y + distance * second[i]) * scale;
+                    }
+                    row.noise->getPoints(px, py, out, n);
+                }
+                else
+                {
+                    const float *sums = row.fields[instruction.index] + start;
+                    const float divisor = row.divisor;
+                    for(unsigned i = 0; i < n; ++i)
+                        out[i] = sums[i] / divisor;
+                }
+                break;
+            case TerrainGraph::REMAP:
+                for(unsigned i = 0; i < n; ++i)
+                    out[i] = World::remap(first[i]);
+                break;
+            case TerrainGraph::CURVE:
+                for(unsigned i = 0; i < n; ++i)
+                    out[i] = evaluateCurve(&points[instruction.index], instruction.pointCount, first[i]);
+                break;
+            case TerrainGraph::ADD:
+                combineRow<TerrainGraph::ADD>(first, second, out, n);
+                break;
+            case TerrainGraph::SUBTRACT:
+                combineRow<TerrainGraph::SUBTRACT>(first, second, out, n);
+                break;
+            case TerrainGraph::MULTIPLY:
+                combineRow<TerrainGraph::MULTIPLY>(first, second, out, n);
+                break;
+            case TerrainGraph::MINIMUM:
+                combineRow<TerrainGraph::MINIMUM>(first, second, out, n);
+                break;
+            default:
+                combineRow<TerrainGraph::MAXIMUM>(first, second, out, n);
+                break;
+            }
+        }
+        const float *heights = read(row, heightOperand, start);
+        const float *moistures = read(row, moistureOperand, start);
+        std::copy(heights, heights + n, height + start);
+        std::copy(moistures, moistures + n, moisture + start);
+    }
+}
@@ -0,0 +1,192 @@
+#ifndef TERRAINGRAPH_H
+#define TERRAINGRAPH_H
+
+#include <stddef.h>
+#include <utility>
+#include <vector>
+#include "PerlinNoise2D.h"
+
+// a recipe for the height and moisture of every tile: noise fields,
+// constants and operations on them. Every function below adds a node and
+// returns its id; inputs are ids of earlier nodes, so the ids are an
+// order in which the graph can be evaluated. Coordinates are tiles of the
+// full world, also when a preview is generated. The functions throw
+// std::invalid_argument when an input is not a node or a parameter is
+// not finite
+class TerrainGraph
+{
+public:
+    enum OP
+    {
+        CONSTANT,
+        NOISE,
+        FALLOFF,
+        REMAP,
+        CURVE,
+        ADD,
+        SUBTRACT,
+        MULTIPLY,
+        MINIMUM,
+        MAXIMUM
+    };
+
+    static const unsigned NO_NODE;
+
+    struct Node
+    {
+        OP op;
+        // inputs; the warp of NOISE, NO_NODE when unused
+        unsigned first, second;
+        // CONSTANT value, FALLOFF exponent, tiles a NOISE is warped by
+        float value;
+        // NOISE lattice offset in tiles and lattice cells per tile
+        long x, y;
+        float scale;
+        // CURVE points, pairs of x and y from points[firstPoint] on
+        unsigned firstPoint, pointCount;
+    };
+
+    unsigned constant(float value);
+
+    // the world noise at lattice point ((x + column) * scale,
+    // (y + row) * scale) of the tile in column and row
+    unsigned noise(long x, long y, float scale);
+
+    // noise() at the point moved by distance * warpX tiles along x and
+    // distance * warpY tiles along y
+    unsigned warpedNoise(long x, long y, float scale, unsigned warpX, unsigned warpY,
+                         float distance);
+
+    // pow(d2, exponent) of the squared distance d2 of a tile to the
+    // center, in halves of the world size
+    unsigned falloff(float exponent);
+
+    // World::remap() of the input
+    unsigned remap(unsigned input);
+
+    // the line through points (x0, y0), (x1, y1), ... at the input, with x
+    // increasing; level beyond the first and last point
+    unsigned curve(unsigned input, const std::vector<float> &points);
+
+    unsigned add(unsigned first, unsigned second);
+    unsigned subtract(unsigned first, unsigned second);
+    unsigned multiply(unsigned first, unsigned second);
+    unsigned minimum(unsigned first, unsigned second);
+    unsigned maximum(unsigned first, unsigned second);
+
+    // the nodes that give the height and the moisture of a tile
+    void setOutputs(unsigned height, unsigned moisture);
+
+    unsigned getHeight() const
+    {
+        return height;
+    }
+
+    unsigned getMoisture() const
+    {
+        return moisture;
+    }
+
+    const std::vector<Node> &getNodes() const
+    {
+        return nodes;
+    }
+
+    const std::vector<float> &getPoints() const
+    {
+        return points;
+    }
+private:
+    std::vector<Node> nodes;
+    std::vector<float> points;
+    unsigned height = NO_NODE, moisture = NO_NODE;
+
+    // throws std::invalid_argument unless the first inputs are nodes
+    unsigned addNode(OP op, unsigned inputs = 0, unsigned first = NO_NODE,
+                     unsigned second = NO_NODE);
+};
+
+// a TerrainGraph compiled into one loop over chunks of tiles: only the
+// nodes the outputs depend on, constant parts folded, and the values of
+// the nodes in as few chunk sized slots as their lifetimes allow, so any
+// recipe runs in one pass over a row without buffers of its own size
+class TerrainProgram
+{
+public:
+    // noise without warp, which the caller passes in row by row so that
+    // it can keep the octaves between generations
+    struct Field
+    {
+        long x, y;
+        float scale;
+    };
+
+    // the inputs and buffers of run() for one row
+    struct Row
+    {
+        // row of the full world and tiles of the full world per tile
+        long y, step;
+        unsigned count;
+        // rows of the fields before their division by divisor, and rows of
+        // the falloffs, in the order of getFields() and getFalloffs()
+        const float *const *fields;
+        float divisor;
+        const float *const *falloffs;
+        // samples the warped noise
+        const PerlinNoise2D *noise;
+        // room for getScratchSize() floats
+        float *scratch;
+    };
+
+    // throws std::invalid_argument when the outputs of graph are not set
+    void compile(const TerrainGraph &graph);
+
+    const std::vector<Field> &getFields() const
+    {
+        return fields;
+    }
+
+    const std::vector<float> &getFalloffs() const
+    {
+        return falloffs;
+    }
+
+    size_t getScratchSize() const;
+
+    // height[i] and moisture[i] of the tiles in row
+    void run(const Row &row, float *height, float *moisture) const;
+private:
+    // one node for a chunk of tiles; constants and falloffs need none,
+    // their values are read where they are
+    struct Instruction
+    {
+        TerrainGraph::OP op;
+        // slot of the result and operands of the inputs
+        unsigned out, first, second;
+        // field of a NOISE without warp, first point of a CURVE
+        unsigned index, pointCount;
+        // a NOISE with warp and the tiles it is warped by
+        long x, y;
+        float scale, distance;
+    };
+
+    // a slot, or a falloff with FALLOFF_OPERAND set
+    static const unsigned FALLOFF_OPERAND;
+    static const unsigned CHUNK;
+
+    std::vector<Instruction> code;
+    std::vector<Field> fields;
+    std::vector<float> falloffs, points;
+    // slots holding a constant, filled once per run()
+    std::vector<std::pair<unsigned, float>> constants;
+    unsigned slots = 0, heightOperand = 0, moistureOperand = 0;
+
+    const float *read(const Row &row, unsigned operand, unsigned start) const
+    {
+        if(operand & FALLOFF_OPERAND)
+            return row.falloffs[operand & ~FALLOFF_OPERAND] + start;
+        return row.scratch + (size_t) operand * CHUNK;
+    }
+};
+
+#endif // TERRAINGRAPH_H
@@ -0,0 +1,96 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+
+// fixed set of worker threads that run index based jobs; the thread
+// calling run() takes part in the work and returns when every index is done
+class ThreadPool
+{
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake, done;
+    const std::function<void(unsigned)> *task;
+    std::atomic<unsigned> next;
+    unsigned count, active;
+    unsigned long generation;
+    bool stopping;
+
+    void work()
+    {
+        for(unsigned i = next++; i < count; i = next++)
+            (*task)(i);
+    }
+
+    void loop()
+    {
+        unsigned long seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        while(true)
+        {
+            wake.wait(lock, [&]() { return stopping || generation != seen; });
+            if(stopping)
+                return;
+            seen = generation;
+            lock.unlock();
+            work();
+            lock.lock();
+            if(--active == 0)
+                done.notify_all();
+        }
+    }
+public:
+    ThreadPool(unsigned threads = std::thread::hardware_concurrency()) :
+        task(nullptr), next(0), count(0), active(0), generation(0), stopping(false)
+    {
+        for(unsigned i = 1; i < threads; ++i)
+            workers.push_back(std::thread(&ThreadPool::loop, this));
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for(auto &w : workers)
+            w.join();
+    }
+
+    unsigned size() const
+    {
+        return workers.size() + 1;
+    }
+
+    // calls job(i) for every i in [0, _count); not reentrant
+    void run(unsigned _count, const std::function<void(unsigned)> &job)
+    {
+        if(workers.empty() || _count <= 1)
+        {
+            for(unsigned i = 0; i < _count; ++i)
+                job(i);
+            return;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        task = &job;
+        count = _count;
+        next = 0;
+        active = workers.size();
+        ++generation;
+        wake.notify_all();
+        lock.unlock();
+        work();
+        lock.lock();
+        done.wait(lock, [&]() { return active == 0; });
+        task = nullptr;
+    }
+};
+
+#endif // THREADPOOL_H
@@ -0,0 +1,101 @@
+#include "World.h"
+#include <ostream>
+#include "RegionMap.h"
+#include "DistanceMap.h"
+#include "BiomeTable.h"
+
+const float World::scale = 0.125f;
+const unsigned World::BAND_ROWS = 16;
+const unsigned World::BIOME_COUNT = 9;
+const unsigned World::HEIGHT_FACTOR = 3;
+const unsigned World::MOISTURE_FACTOR = 1;
+// rivers routed at once; a router has buffers of the world size, so
+// their number does not follow the size of the pool
+const unsigned World::MAX_ROUTERS = 4;
+
+const uint8_t World::COLORS[][3] = {
+    {0, 30, 100}, // ocean
+    {255, 255, 20}, // beach
+    {120, 170, 0}, // steppe
+    {0, 150, 20}, // grassland
+    {0, 120, 50}, // forest
+    {120, 120, 120}, // mountains
+    {255, 255, 255}, // snow
+    {0, 150, 255}, // lake
+    {0, 60, 150}, // coast
+    {0, 150, 255} // river
+};
+
+const char *const World::BIOME_NAMES[] = {
+    "ocean",
+    "beach",
+    "steppe",
+    "grassland",
+    "forest",
+    "mountains",
+    "snow",
+    "lake",
+    "coast",
+    "river"
+};
+
+void World::classifyRow(Band &band, unsigned y, const float *moisture)
+{
+    BIOME *row = tiles[y];
+    (biomes ? *biomes : BiomeTable::getDefault()).classify(heightmap[y], moisture, row, width);
+    for(unsigned x = 0; x < width; ++x)
+    {
+        coastBackup.set(x, y, row[x] == BIOME::COAST);
+        if(row[x] == BIOME::COAST)
+            row[x] = BIOME::OCEAN;
+        if(row[x] == BIOME::OCEAN)
+            ++band.waterCount;
+    }
+}
+
+void World::buildRegionMap()
+{
+    Clock::time_point start;
+    if(stats)
+        start = Clock::now();
+    regionMap->build(*this);
+    if(stats)
+        stats->regionSeconds = elapsed(start);
+}
+
+void World::buildDistanceMap()
+{
+    Clock::time_point start;
+    if(stats)
+        start = Clock::now();
+    distanceMap->build(*this, pool);
+    if(stats)
+        stats->distanceSeconds = elapsed(start);
+}
+
+void GenerationStats::print(std::ostream &out) const
+{
+    out << "terrain: " << terrainSeconds * 1000 << " ms, water " <<
+           waterFactor * 100 << "%" << ", " << noiseOctaves << " noise octaves computed" <<
+           (falloffReused ? ", falloff reused" : "") << "\n";
+    if(erosionSeconds > 0.0)
+        out << "erosion: " << erosionSeconds * 1000 << " ms\n";
+    for(auto &pass : passes)
+        out << "adjust " << World::BIOME_NAMES[pass.biome] <<
+               (pass.special ? " (special)" : "") << ": " <<
+               pass.seconds * 1000 << " ms, " << pass.regions << " regions (" <<
+               pass.smallest << " to " << pass.largest << " tiles), " <<
+               pass.reassigned << " reassigned\n";
+    if(!passes.empty())
+        out << "coast restore: " << coastSeconds * 1000 << " ms\n";
+    for(unsigned i = 0; i < rivers.size(); ++i)
+        out << "river " << i << ": " << rivers[i].seconds * 1000 << " ms, " <<
+               rivers[i].pushed << " pushed, " << rivers[i].popped << " popped, " <<
+               rivers[i].length << " tiles long\n";
+    out << "rivers: " << riverCount << " of " << sourceCandidates << " candidates\n";
+    if(regionSeconds > 0.0)
+        out << "region map: " << regionSeconds * 1000 << " ms\n";
+    if(distanceSeconds > 0.0)
+        out << "distance map: " << distanceSeconds * 1000 << " ms\n";
+    out << "total: " << totalSeconds * 1000 << " ms\n";
+}
@@ -0,0 +1,961 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include <chrono>
+#include <ostream>
+#include <math.h>
+#include <stdint.h>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+#include "PerlinNoise2D.h"
+#include "ThreadPool.h"
+#include "Grid.h"
+#include "RiverRouter.h"
+#include "Erosion.h"
+#include "PoissonDisk.h"
+#include "TerrainGraph.h"
+
+class RegionMap;
+class DistanceMap;
+class BiomeTable;
+
+// what World::generate spent its time on; filled only when World::stats
+// points to one, times are in seconds
+struct GenerationStats
+{
+    // one adjustBiome call
+    struct Pass
+    {
+        unsigned biome;
+        bool special;
+        double seconds;
+        unsigned long regions, reassigned, smallest, largest;
+    };
+
+    struct River
+    {
+        double seconds;
+        unsigned long pushed, popped, length;
+    };
+
+    double terrainSeconds = 0.0, coastSeconds = 0.0, totalSeconds = 0.0;
+    // part of terrainSeconds, zero when the world was not eroded
+    double erosionSeconds = 0.0;
+    // building World::regionMap and World::distanceMap, zero without them
+    double regionSeconds = 0.0, distanceSeconds = 0.0;
+    std::vector<Pass> passes;
+    std::vector<River> rivers;
+    float waterFactor = 0.0f;
+    unsigned riverCount = 0;
+    // candidates the river sources were chosen from
+    unsigned long sourceCandidates = 0;
+    // most noise octaves generateTerrain had to compute for a field, and
+    // whether it reused the cached falloffs
+    unsigned noiseOctaves = 0;
+    bool falloffReused = false;
+
+    void clear()
+    {
+        *this = GenerationStats();
+    }
+
+    void print(std::ostream &out) const;
+};
+
+// everything one generation of a world depends on
+struct WorldSettings
+{
+    unsigned long seed = 0;
+    PerlinNoise2D::HASH hash = PerlinNoise2D::POLYNOMIAL;
+    unsigned octaves = 5;
+    float a = 0.1f, b = 0.55f, c = 1.4f;
+    // see World::warp
+    float warp = 0.0f;
+    bool adjust = true;
+    // erode the heightmap before the biomes are assigned
+    bool erode = false;
+    // see World::maxRivers
+    unsigned maxRivers = 5;
+    // see World::biomes and World::terrain
+    const BiomeTable *biomes = nullptr;
+    const TerrainGraph *terrain = nullptr;
+    // fill the GenerationStats of the world
+    bool stats = false;
+};
+
+class World
+{
+    // shares the per-tile terrain rules
+    friend class ChunkedWorld;
+public:
+    enum BIOME : uint8_t
+    {
+        OCEAN,
+        BEACH,
+        STEPPE,
+        GRASSLAND,
+        FOREST,
+        MOUNTAINS,
+        SNOW,
+        LAKE,
+        COAST,
+        RIVER
+    };
+
+    Grid<BIOME> tiles;
+
+    PerlinNoise2D *noise;
+
+    // optional, generates on the calling thread only when not set
+    ThreadPool *pool = nullptr;
+
+    // optional, collects timings and counters of generate() when set
+    GenerationStats *stats = nullptr;
+
+    // optional, erodes the heightmap between the terrain pass and the
+    // biomes when set, so biomes and rivers follow the eroded valleys; the
+    // result depends only on the seed of noise
+    Erosion *erosion = nullptr;
+
+    // optional, assigns the biomes by its rules instead of the default
+    // ones when set
+    const BiomeTable *biomes = nullptr;
+
+    // optional, computes height and moisture of every tile by its recipe
+    // instead of the default one of a, b, c and warp when set; generate()
+    // throws std::invalid_argument when its outputs are not set
+    const TerrainGraph *terrain = nullptr;
+
+    // optional, rebuilt from the final tiles at the end of generate()
+    // when set, for region and nearest biome queries on the world
+    RegionMap *regionMap = nullptr;
+
+    // optional, recomputed from the final tiles and heightmap at the end
+    // of generate() when set, for distances to water and coastlines
+    DistanceMap *distanceMap = nullptr;
+
+    // keeps the noise octaves and the falloffs between calls, 4 bytes per
+    // tile and octave of every noise field without warp plus 4 per
+    // falloff, so that changing a, b, c or adjust redoes only the stages
+    // that depend on it and changing the octaves computes only octaves
+    // that were not computed before; all of it is redone when the seed or
+    // the hash of noise change
+    bool cacheFields = true;
+
+    static const uint8_t COLORS[][3];
+    static const char *const BIOME_NAMES[];
+
+    float a = 0.1f, b = 0.55f, c = 1.4f;
+    //best so far: (a;b;c)=(0.15;0.5;1.4)
+    //best so far: (a;b;c)=(0.1;0.55;1.4)
+    //best so far: (a;b;c)=(0.0;0.6;4.0)
+
+    // tiles of the full world by which the default recipe moves the height
+    // noise along two further noise fields, 0 for none
+    float warp = 0.0f;
+
+    // rivers of a world with little water, fewer the more water it has;
+    // their sources are the best scored of candidates that are at least
+    // sourceSpacing tiles of the full world apart
+    unsigned maxRivers = 5;
+    float sourceSpacing = 16.0f;
+
+    // a world of _width x _height tiles, or with _step above 1 a preview
+    // of it at 1/_step resolution, whose tile (x, y) has the terrain of
+    // tile (x * _step, y * _step); region sizes are counted in tiles of
+    // the full world and rivers are one tile wide
+    World(unsigned _width, unsigned _height, unsigned _step = 1) :
+        tiles(reduce(_width, _step), reduce(_height, _step)),
+        width(reduce(_width, _step)), height(reduce(_height, _step)),
+        step(_step), fullWidth(_width), fullHeight(_height),
+        coastBackup(width, height), heightmap(width, height), moistureMap(0, 0)
+    {
+        if(_step == 0)
+            throw std::invalid_argument("World step must be positive");
+        // region labels are 32 bit
+        if((unsigned long long) width * height >= NO_REGION)
+            throw std::invalid_argument("World is too large");
+    }
+
+    // size in tiles, smaller than the full world for a preview
+    unsigned getWidth() const
+    {
+        return width;
+    }
+
+    unsigned getHeight() const
+    {
+        return height;
+    }
+
+    // tiles of the full world per tile along each axis
+    unsigned getStep() const
+    {
+        return step;
+    }
+
+    const Grid<float> &getHeightmap() const
+    {
+        return heightmap;
+    }
+
+    // the recipe generate() follows without terrain: the remapped height
+    // noise plus a, less b times the falloff with exponent c, and at least
+    // -1; the remapped moisture noise
+    TerrainGraph getDefaultTerrain() const
+    {
+        TerrainGraph graph;
+        unsigned heightNoise;
+        if(warp != 0.0f)
+            heightNoise = graph.warpedNoise(0, 0, scale, graph.noise(211, 0, 0.0625f),
+                                            graph.noise(0, 211, 0.0625f), warp);
+        else
+            heightNoise = graph.noise(0, 0, scale);
+        unsigned elevation = graph.add(graph.remap(heightNoise), graph.constant(a));
+        elevation = graph.subtract(elevation, graph.multiply(graph.constant(b), graph.falloff(c)));
+        graph.setOutputs(graph.maximum(elevation, graph.constant(-1.0f)),
+                         graph.remap(graph.noise(53, 71, 0.0625f)));
+        return graph;
+    }
+
+    void generate(bool adjust)
+    {
+        Clock::time_point start;
+        if(stats)
+        {
+            stats->clear();
+            start = Clock::now();
+        }
+        generateTerrain();
+        if(adjust)
+            adjustBiomes();
+        generateRivers();
+        if(regionMap)
+            buildRegionMap();
+        if(distanceMap)
+            buildDistanceMap();
+        if(stats)
+            stats->totalSeconds = elapsed(start);
+
+        //TODO go through river and modify neighbours to become
+        //beach if there is very little level of moisture
+        //forest if there is very big level of moisture
+    }
+
+    // the stages of generate() in the order it runs them
+
+    // computes height, moisture and biome of every tile and picks the
+    // river sources and the river count
+    void generateTerrain()
+    {
+        float riverLevel;
+        unsigned long waterCount = 0;
+        unsigned bandCount = (height + BAND_ROWS - 1) / BAND_ROWS;
+        std::vector<Band> bands(bandCount);
+        Clock::time_point start;
+        if(stats)
+            start = Clock::now();
+        program.compile(terrain ? *terrain : getDefaultTerrain());
+        unsigned octaves = noise->getOctaves(), noiseOctaves = 0;
+        bool noiseCached = cacheFields && noiseValid && noiseSeed == noise->getSeed() &&
+                           noiseHash == noise->getHash();
+        bool falloffReused = true;
+        // the caches of the fields and falloffs of the program, those of
+        // the last call when it had them too
+        std::vector<FieldCache> fields(program.getFields().size());
+        std::vector<FalloffCache> falloffs(program.getFalloffs().size());
+        for(unsigned f = 0; f < fields.size(); ++f)
+        {
+            FieldCache &cache = fields[f];
+            const TerrainProgram::Field &field = cache.field = program.getFields()[f];
+            for(auto &cached : fieldCaches)
+                if(cacheFields && cached.field.x == field.x && cached.field.y == field.y &&
+                   cached.field.scale == field.scale)
+                {
+                    cache.sums.swap(cached.sums);
+                    cache.octaves = cached.octaves;
+                }
+            cache.first = noiseCached ? std::min(cache.octaves, octaves) : 0;
+            if(cacheFields)
+                while(cache.sums.size() < octaves)
+                    cache.sums.emplace_back(width, height);
+            noiseOctaves = std::max(noiseOctaves, octaves - cache.first);
+        }
+        for(unsigned f = 0; f < falloffs.size(); ++f)
+        {
+            FalloffCache &cache = falloffs[f];
+            cache.exponent = program.getFalloffs()[f];
+            for(auto &cached : falloffCaches)
+                if(cacheFields && cached.exponent == cache.exponent)
+                {
+                    std::swap(cache.values, cached.values);
+                    cache.compute = !falloffValid;
+                }
+            if(cacheFields)
+                cache.values.resize(width, height);
+            falloffReused = falloffReused && !cache.compute;
+        }
+        fieldCaches.swap(fields);
+        falloffCaches.swap(falloffs);
+        if(erosion)
+            moistureMap.resize(width, height);
+        else
+            moistureMap = Grid<float>(0, 0);
+        sampleSources();
+
+        // bands are fixed size and merged in order, so the result does
+        // not depend on how many threads processed them
+        std::function<void(unsigned)> job = [&](unsigned i)
+        {
+            generateBand(bands[i], i * BAND_ROWS, std::min((i + 1) * BAND_ROWS, height));
+        };
+        if(pool)
+            pool->run(bandCount, job);
+        else
+            for(unsigned i = 0; i < bandCount; ++i)
+                job(i);
+        if(erosion)
+        {
+            // the bands only computed heights and moisture
+            Clock::time_point erosionStart;
+            if(stats)
+                erosionStart = Clock::now();
+            erosion->run(heightmap, noise->getSeed(), pool);
+            if(stats)
+                stats->erosionSeconds = elapsed(erosionStart);
+            std::function<void(unsigned)> classifyJob = [&](unsigned i)
+            {
+                unsigned y1 = std::min((i + 1) * BAND_ROWS, height);
+                for(unsigned y = i * BAND_ROWS; y < y1; ++y)
+                {
+                    const float *moistureRow = moistureMap[y];
+                    classifyRow(bands[i], y, moistureRow);
+                    addSources(bands[i], y, [moistureRow](unsigned x)
+                    {
+                        return moistureRow[x];
+                    });
+                }
+            };
+            if(pool)
+                pool->run(bandCount, classifyJob);
+            else
+                for(unsigned i = 0; i < bandCount; ++i)
+                    classifyJob(i);
+        }
+        noiseValid = falloffValid = cacheFields;
+        noiseSeed = noise->getSeed();
+        noiseHash = noise->getHash();
+        for(auto &field : fieldCaches)
+            if(field.first < octaves)
+                field.octaves = octaves;
+
+        sources.clear();
+        for(auto &band : bands)
+        {
+            waterCount += band.waterCount;
+            sources.insert(sources.end(), band.sources.begin(), band.sources.end());
+        }
+        unsigned long candidates = sources.size();
+        // best first, ties in scan order
+        size_t best = std::min<size_t>(maxRivers, sources.size());
+        std::partial_sort(sources.begin(), sources.begin() + best, sources.end(),
+                          [](const SourceCandidate &first, const SourceCandidate &second)
+        {
+            if(first.factor != second.factor)
+                return first.factor > second.factor;
+            return first.y != second.y ? first.y < second.y : first.x < second.x;
+        });
+        sources.resize(best);
+        riverLevel = 0.1f / maxRivers;
+        waterFactor = ((float) waterCount) / ((unsigned long long) width * height);
+        if(waterFactor <= 0.7f + riverLevel)
+            riverCount = maxRivers;
+        else if(waterFactor >= 0.8f - riverLevel)
+            riverCount = 1;
+        else
+            riverCount = ((int)((0.8f - waterFactor) / riverLevel)) + 1;
+        riverCount = std::min<unsigned>(riverCount, sources.size());
+        if(stats)
+        {
+            stats->terrainSeconds = elapsed(start);
+            stats->noiseOctaves = noiseOctaves;
+            stats->falloffReused = !falloffCaches.empty() && falloffReused;
+            stats->waterFactor = waterFactor;
+            stats->riverCount = riverCount;
+            stats->sourceCandidates = candidates;
+        }
+    }
+
+    // merges small regions into their surroundings and turns inland
+    // oceans into lakes
+    void adjustBiomes()
+    {
+        for(unsigned b = BIOME::OCEAN; b <= BIOME::SNOW; ++b)
+            adjustBiome(b);
+        restoreCoast();
+        adjustBiome(BIOME::COAST);
+        adjustBiome(BIOME::OCEAN, true);
+    }
+
+    // one region pass of adjustBiomes() for biome b
+    void adjustBiome(unsigned b, bool special = false)
+    {
+        unsigned long *neighbourCount;
+        unsigned newBiome, r, found[4];
+        size_t index;
+        unsigned n, k, smallCount = 0;
+        Clock::time_point start;
+        if(stats)
+            start = Clock::now();
+        labels.resize((size_t) width * height);
+        regions.clear();
+        // label all regions of b at once; beaches are 8-connected
+        for(unsigned y = 0; y < height; ++y)
+            for(unsigned x = 0; x < width; ++x)
+            {
+                index = getIndex(x, y);
+                if(tiles[y][x] != b)
+                {
+                    labels[index] = NO_REGION;
+                    continue;
+                }
+                labels[index] = (unsigned) index;
+                if(x > 0 && tiles[y][x - 1] == b)
+                    unite(index, index - 1);
+                if(y > 0)
+                {
+                    if(tiles[y - 1][x] == b)
+                        unite(index, index - width);
+                    if(b == BIOME::BEACH)
+                    {
+                        if(x > 0 && tiles[y - 1][x - 1] == b)
+                            unite(index, index - width - 1);
+                        if(x < width - 1 && tiles[y - 1][x + 1] == b)
+                            unite(index, index - width + 1);
+                    }
+                }
+            }
+        // turn parent links into region ids; parents come first in scan
+        // order, so they already hold their region id when it is needed
+        for(unsigned y = 0; y < height; ++y)
+            for(unsigned x = 0; x < width; ++x)
+            {
+                index = getIndex(x, y);
+                if(labels[index] == NO_REGION)
+                    continue;
+                if(labels[index] == index)
+                {
+                    labels[index] = regions.size();
+                    regions.push_back(Region());
+                }
+                else
+                    labels[index] = labels[labels[index]];
+                Region &region = regions[labels[index]];
+                ++region.size;
+                if(x == 0 || y == 0 || x == width - 1 || y == height - 1)
+                    region.touchesEdge = true;
+            }
+        // sizes in tiles of the full world
+        unsigned long area = (unsigned long) step * step;
+        for(auto &region : regions)
+        {
+            if((b != BIOME::OCEAN && region.size * area < 100) ||
+               (b == BIOME::OCEAN && region.size * area < 50) ||
+               (b == BIOME::OCEAN && special && region.size * area < 300))
+                region.histogram = smallCount++;
+            else if(b == BIOME::OCEAN && !region.touchesEdge &&
+                    !special && region.size * area >= 50)
+                region.newBiome = BIOME::LAKE;
+            else
+                region.newBiome = b;
+        }
+        if(smallCount != 0)
+        {
+            // every neighbouring tile counts once per region it touches
+            histograms.assign(smallCount * BIOME_COUNT, 0);
+            for(unsigned y = 0; y < height; ++y)
+                for(unsigned x = 0; x < width; ++x)
+                {
+                    if(tiles[y][x] == b)
+                        continue;
+                    index = getIndex(x, y);
+                    n = 0;
+                    if(y > 0 && labels[index - width] != NO_REGION)
+                        found[n++] = labels[index - width];
+                    if(x < width - 1 && labels[index + 1] != NO_REGION)
+                        found[n++] = labels[index + 1];
+                    if(y < height - 1 && labels[index + width] != NO_REGION)
+                        found[n++] = labels[index + width];
+                    if(x > 0 && labels[index - 1] != NO_REGION)
+                        found[n++] = labels[index - 1];
+                    for(unsigned i = 0; i < n; ++i)
+                    {
+                        r = found[i];
+                        for(k = 0; k < i && found[k] != r; ++k);
+                        if(k == i && regions[r].histogram != NO_REGION)
+                            ++histograms[regions[r].histogram * BIOME_COUNT + tiles[y][x]];
+                    }
+                }
+            for(auto &region : regions)
+            {
+                if(region.histogram == NO_REGION)
+                    continue;
+                neighbourCount = &histograms[region.histogram * BIOME_COUNT];
+                newBiome = 0;
+                for(unsigned i = 1; i < BIOME_COUNT; ++i)
+                    if(neighbourCount[i] > neighbourCount[newBiome])
+                        newBiome = i;
+                region.newBiome = newBiome;
+            }
+        }
+        for(unsigned y = 0; y < height; ++y)
+            for(unsigned x = 0; x < width; ++x)
+            {
+                index = labels[getIndex(x, y)];
+                if(index != NO_REGION)
+                    tiles[y][x] = (BIOME) regions[index].newBiome;
+            }
+        if(stats)
+        {
+            GenerationStats::Pass pass = {b, special, elapsed(start), (unsigned long) regions.size(), 0,
+                                          regions.empty() ? 0 : (unsigned long) -1, 0};
+            for(auto &region : regions)
+            {
+                if(region.newBiome != b)
+                    ++pass.reassigned;
+                pass.smallest = std::min(pass.smallest, region.size);
+                pass.largest = std::max(pass.largest, region.size);
+            }
+            stats->passes.push_back(pass);
+        }
+    }
+
+    // coast tiles are classified as ocean until the ocean regions are
+    // adjusted; turns the ones that stayed ocean back into coast
+    void restoreCoast()
+    {
+        Clock::time_point start;
+        if(stats)
+            start = Clock::now();
+        for(unsigned y = 0; y < height; ++y)
+            for(unsigned x = 0; x < width; ++x)
+                if(coastBackup.get(x, y) && tiles[y][x] == BIOME::OCEAN)
+                    tiles[y][x] = BIOME::COAST;
+        if(stats)
+            stats->coastSeconds = elapsed(start);
+    }
+
+    // routes rivers of one batch concurrently and paints them in order;
+    // a river whose search opened a tile painted earlier in its batch is
+    // routed again, so the result matches generating them one by one
+    void generateRivers()
+    {
+        unsigned batch = pool ? std::min(std::min(pool->size(), MAX_ROUTERS), riverCount) : 1;
+        if(batch < 2)
+        {
+            for(unsigned i = 0; i < riverCount; ++i)
+                generateRiver(i);
+            return;
+        }
+        while(routers.size() < batch)
+            routers.emplace_back(width, height);
+        std::vector<uint32_t> targets(batch), painted;
+        std::vector<double> seconds(stats ? batch : 0);
+        for(unsigned first = 0; first < riverCount; first += batch)
+        {
+            unsigned count = std::min(batch, riverCount - first);
+            pool->run(count, [&](unsigned j)
+            {
+                Clock::time_point start;
+                if(stats)
+                    start = Clock::now();
+                targets[j] = routeRiver(routers[j], first + j);
+                if(stats)
+                    seconds[j] = elapsed(start);
+            });
+            painted.clear();
+            for(unsigned j = 0; j < count; ++j)
+            {
+                RiverRouter &router = routers[j];
+                Clock::time_point start;
+                if(stats)
+                    start = Clock::now();
+                for(auto index : painted)
+                    if(router.opened(index))
+                    {
+                        targets[j] = routeRiver(router, first + j);
+                        break;
+                    }
+                unsigned long length = paintRiver(router, first + j, targets[j], &painted);
+                if(stats)
+                {
+                    GenerationStats::River river = {seconds[j] + elapsed(start), router.pushed,
+                                                    router.popped, length};
+                    stats->rivers.push_back(river);
+                }
+            }
+        }
+    }
+
+    // routes river i downhill from its source until it reaches water
+    void generateRiver(unsigned i)
+    {
+        Clock::time_point start;
+        if(stats)
+            start = Clock::now();
+        if(routers.empty())
+            routers.emplace_back(width, height);
+        RiverRouter &router = routers[0];
+        /*
+        TODO:
+        try not opening points and not using flowmap but create river in realtime
+
+        TODO:
+        try creating river in realtime and change terrain under it
+        */
+        unsigned long length = paintRiver(router, i, routeRiver(router, i), nullptr);
+        if(stats)
+        {
+            GenerationStats::River river = {elapsed(start), router.pushed, router.popped, length};
+            stats->rivers.push_back(river);
+        }
+    }
+
+    unsigned getRiverCount() const
+    {
+        return riverCount;
+    }
+
+    // share of ocean and coast tiles before the region passes
+    float getWaterFactor() const
+    {
+        return waterFactor;
+    }
+
+    // labels the final tiles into regionMap
+    void buildRegionMap();
+
+    // computes the distances and coastlines of distanceMap
+    void buildDistanceMap();
+
+    // the curve noise values go through before they are heights and
+    // moistures
+    static float remap(float height)
+    {
+        // the constants of the piece height is in go into one expression;
+        // selecting constants has no branches, so a row of them vectorizes
+        bool above = height > 0.5f, below = height < -0.5f;
+        float shift = above ? -0.5f : below ? 0.5f : 0.0f;
+        float slope = above || below ? 0.2f : 1.8f;
+        float offset = above ? 0.9f : below ? -0.9f : 0.0f;
+        return (height + shift) * slope + offset;
+    }
+
+    // makes the next generate() recompute the cached fields
+    void invalidate()
+    {
+        noiseValid = falloffValid = false;
+    }
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    static double elapsed(Clock::time_point start)
+    {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    struct SourceCandidate
+    {
+        float factor = 0.0f;
+        unsigned x = 0, y = 0;
+    };
+
+    // per band results of the per-pixel pass
+    struct Band
+    {
+        unsigned long waterCount = 0;
+        std::vector<SourceCandidate> sources;
+    };
+
+    // connected area of one biome found by adjustBiome
+    struct Region
+    {
+        unsigned long size = 0;
+        bool touchesEdge = false;
+        unsigned histogram = NO_REGION;
+        unsigned newBiome = BIOME::OCEAN;
+    };
+
+    static const float scale;
+    static const unsigned BAND_ROWS;
+    static const unsigned NO_REGION = ~0u;
+    static const unsigned BIOME_COUNT;
+    static const unsigned HEIGHT_FACTOR;
+    static const unsigned MOISTURE_FACTOR;
+    static const unsigned MAX_ROUTERS;
+    unsigned width, height;
+    unsigned step, fullWidth, fullHeight;
+    BitGrid coastBackup;
+    Grid<float> heightmap;
+    // the compiled recipe of the last generateTerrain()
+    TerrainProgram program;
+    // when cacheFields is set, sums[o] holds octaves 0 to o of the field
+    // before the division by the noise scale, octaves of them are valid;
+    // octaves from first on are computed by this generateTerrain()
+    struct FieldCache
+    {
+        TerrainProgram::Field field;
+        std::vector<Grid<float>> sums;
+        unsigned octaves = 0, first = 0;
+    };
+    // when cacheFields is set, values holds pow(d2, exponent) of every
+    // tile; it is computed by this generateTerrain() when compute is set
+    struct FalloffCache
+    {
+        float exponent = 0.0f;
+        Grid<float> values = Grid<float>(0, 0);
+        bool compute = true;
+    };
+    std::vector<FieldCache> fieldCaches;
+    std::vector<FalloffCache> falloffCaches;
+    // moisture of every tile, kept only while erosion runs between the
+    // terrain pass and the biomes
+    Grid<float> moistureMap;
+    bool noiseValid = false, falloffValid = false;
+    unsigned long noiseSeed = 0;
+    PerlinNoise2D::HASH noiseHash = PerlinNoise2D::POLYNOMIAL;
+    std::vector<SourceCandidate> sources;
+    PoissonDisk sampler;
+    // the source candidates of row y are in the columns
+    // candidateX[candidateStart[y]] up to candidateStart[y + 1]
+    std::vector<uint32_t> candidateStart, candidateX;
+    bool candidatesValid = false;
+    unsigned long candidateSeed = 0;
+    float candidateSpacing = 0.0f;
+    float waterFactor = 0.0f;
+    unsigned riverCount = 0;
+    // one per concurrently routed river, created on first use; each has
+    // 5 bytes per tile, so there are at most MAX_ROUTERS of them whatever
+    // the size of the pool
+    std::vector<RiverRouter> routers;
+    std::vector<unsigned> labels;
+    std::vector<Region> regions;
+    std::vector<unsigned long> histograms;
+
+    // computes height, moisture and biome for rows [y0, y1) and collects
+    // river source candidates in scan order; the noise octaves of a field
+    // below its first and the falloffs without compute come from the
+    // cached fields
+    void generateBand(Band &band, unsigned y0, unsigned y1)
+    {
+        unsigned octaves = noise->getOctaves();
+        size_t fieldCount = fieldCaches.size(), falloffCount = falloffCaches.size();
+        // rows of getRow() are already divided
+        float divisor = cacheFields ? noise->getScale() : 1.0f;
+        // rows of the fields and the falloffs when they are not cached
+        std::vector<float> buffer(cacheFields ? 0 : (fieldCount + falloffCount) * width);
+        std::vector<float> scratch(program.getScratchSize());
+        // remapped moisture of a row that is classified right away
+        std::vector<float> moistures(erosion ? 0 : width);
+        std::vector<float *> sumRows(octaves);
+        std::vector<const float *> fieldRows(fieldCount), falloffRows(falloffCount);
+        TerrainProgram::Row row;
+        row.step = step;
+        row.count = width;
+        row.fields = fieldRows.data();
+        row.divisor = divisor;
+        row.falloffs = falloffRows.data();
+        row.noise = noise;
+        row.scratch = scratch.data();
+        for(unsigned y = y0; y < y1; ++y)
+        {
+            // row of the full world
+            long fullY = (long) y * step;
+            for(size_t f = 0; f < fieldCount; ++f)
+            {
+                FieldCache &cache = fieldCaches[f];
+                const TerrainProgram::Field &field = cache.field;
+                if(cacheFields)
+                {
+                    for(unsigned o = 0; o < octaves; ++o)
+                        sumRows[o] = cache.sums[o][y];
+                    if(cache.first < octaves)
+                        noise->getOctaveSums(sumRows.data(), cache.first, width, field.x,
+                                             fullY + field.y, field.scale, step);
+                    fieldRows[f] = sumRows[octaves - 1];
+                }
+                else
+                {
+                    float *out = &buffer[f * width];
+                    noise->getRow(out, width, field.x, fullY + field.y, field.scale, step);
+                    fieldRows[f] = out;
+                }
+            }
+            for(size_t f = 0; f < falloffCount; ++f)
+            {
+                FalloffCache &cache = falloffCaches[f];
+                float *out = cacheFields ? cache.values[y] : &buffer[(fieldCount + f) * width];
+                if(cache.compute)
+                    for(unsigned x = 0; x < width; ++x)
+                    {
+                        float dx = 2.0f * (float) (x * step) / fullWidth - 1.0f;
+                        float dy = 2.0f * (float) fullY / fullHeight - 1.0f;
+                        float d2 = dx * dx + dy * dy;
+                        out[x] = pow(d2, cache.exponent);
+                    }
+                falloffRows[f] = out;
+            }
+            row.y = fullY;
+            float *moisture = erosion ? moistureMap[y] : moistures.data();
+            program.run(row, heightmap[y], moisture);
+            if(!erosion)
+            {
+                classifyRow(band, y, moisture);
+                addSources(band, y, [moisture](unsigned x)
+                {
+                    return moisture[x];
+                });
+            }
+        }
+    }
+
+    // biomes of row y from its heights and moisture, counted as water in
+    // band
+    void classifyRow(Band &band, unsigned y, const float *moisture);
+
+    // places the source candidates on the full world, at least
+    // sourceSpacing apart, and gives them to the tiles that cover them;
+    // they only change with the seed and the spacing
+    void sampleSources()
+    {
+        if(candidatesValid && candidateSeed == noise->getSeed() &&
+           candidateSpacing == sourceSpacing)
+            return;
+        const std::vector<PoissonDisk::Point> &points =
+            sampler.sample(fullWidth, fullHeight, sourceSpacing, noise->getSeed());
+        // several candidates may fall on one tile of a preview
+        std::vector<uint64_t> keys;
+        keys.reserve(points.size());
+        for(auto &point : points)
+            keys.push_back((uint64_t) ((unsigned) point.y / step) << 32 | (unsigned) point.x / step);
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        candidateStart.assign(height + 1, 0);
+        candidateX.clear();
+        for(auto key : keys)
+        {
+            ++candidateStart[(key >> 32) + 1];
+            candidateX.push_back((uint32_t) key);
+        }
+        for(unsigned y = 0; y < height; ++y)
+            candidateStart[y + 1] += candidateStart[y];
+        candidatesValid = true;
+        candidateSeed = noise->getSeed();
+        candidateSpacing = sourceSpacing;
+    }
+
+    // scores the source candidates of row y into band once the row has
+    // its heights; moisture(x) is the moisture of tile (x, y)
+    template<class Moisture>
+    void addSources(Band &band, unsigned y, Moisture moisture)
+    {
+        for(uint32_t i = candidateStart[y]; i < candidateStart[y + 1]; ++i)
+        {
+            SourceCandidate source;
+            source.x = candidateX[i];
+            source.y = y;
+            source.factor = (heightmap[y][source.x] + 1.0f) * HEIGHT_FACTOR +
+                            (moisture(source.x) + 1.0f) * MOISTURE_FACTOR;
+            band.sources.push_back(source);
+        }
+    }
+
+    // searches from the source of river i and returns the water tile the
+    // river flows into
+    uint32_t routeRiver(RiverRouter &router, unsigned i) const
+    {
+        const BIOME *cells = tiles.data();
+        return router.search(heightmap.data(), (uint32_t) getIndex(sources[i].x, sources[i].y),
+                             [cells](uint32_t index)
+        {
+            BIOME tile = cells[index];
+            return tile == BIOME::OCEAN || tile == BIOME::COAST ||
+                   tile == BIOME::LAKE || tile == BIOME::RIVER;
+        });
+    }
+
+    // paints the path the last search of router found from the target
+    // back to the source of river i and returns its length; painted tiles
+    // are appended to painted when it is set
+    unsigned long paintRiver(const RiverRouter &router, unsigned i, uint32_t target,
+                             std::vector<uint32_t> *painted)
+    {
+        unsigned long length = 0;
+        uint32_t source = (uint32_t) getIndex(sources[i].x, sources[i].y);
+        if(target == RiverRouter::NO_TARGET)
+            return 0;
+        for(uint32_t index = target; index != source; ++length)
+        {
+            index = router.parent(index);
+            unsigned x = index % width, y = index / width;
+            paintTile(x, y, painted);
+            // a river is three tiles wide, less than two tiles of a preview
+            if(step > 1)
+                continue;
+            if(y < height - 1)
+                paintTile(x, y + 1, painted);
+            if(y > 0)
+                paintTile(x, y - 1, painted);
+            if(x < width - 1)
+                paintTile(x + 1, y, painted);
+            if(x > 0)
+                paintTile(x - 1, y, painted);
+        }
+        return length;
+    }
+
+    void paintTile(unsigned x, unsigned y, std::vector<uint32_t> *painted)
+    {
+        tiles[y][x] = BIOME::RIVER;
+        if(painted)
+            painted->push_back((uint32_t) getIndex(x, y));
+    }
+
+    // finds the root of a region; every parent has a lower index than its
+    // children, so roots are the first tile of their region in scan order
+    unsigned findRoot(size_t i)
+    {
+        while(labels[i] != i)
+        {
+            labels[i] = labels[labels[i]];
+            i = labels[i];
+        }
+        return i;
+    }
+
+    void unite(size_t first, size_t second)
+    {
+        unsigned i = findRoot(first);
+        unsigned j = findRoot(second);
+        if(i < j)
+            labels[j] = i;
+        else if(j < i)
+            labels[i] = j;
+    }
+
+    // tiles of a preview at 1/step resolution along an axis of size tiles
+    static unsigned reduce(unsigned size, unsigned step)
+    {
+        return step ? (size + step - 1) / step : size;
+    }
+
+    inline size_t getIndex(unsigned x, unsigned y) const
+    {
+        return (size_t) y * width + x;
+    }
+
+};
+
+#endif // WORLD_H
@@ -0,0 +1,165 @@
+#include "WorldFile.h"
+#include <string.h>
+#include <fstream>
+#include <vector>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const char WorldFile::MAGIC[4] = {'P', 'W', 'L', 'D'};
+const uint32_t WorldFile::VERSION = 1;
+
+namespace
+{
+    // sections start on a page, so each of them can be mapped on its own
+    const uint64_t PAGE = 4096;
+    const uint32_t ORDER_MARK = 0x01020304;
+
+    uint64_t alignPage(uint64_t offset)
+    {
+        return (offset + PAGE - 1) / PAGE * PAGE;
+    }
+
+    void pad(std::ofstream &file, uint64_t offset)
+    {
+        static const char zeros[PAGE] = {};
+        uint64_t position = file.tellp();
+        if(position < offset)
+            file.write(zeros, offset - position);
+    }
+}
+
+bool saveWorld(const World &world, bool adjust, const std::string &path)
+{
+    unsigned width = world.getWidth(), height = world.getHeight();
+    WorldFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, WorldFile::MAGIC, 4);
+    header.version = WorldFile::VERSION;
+    header.byteOrder = ORDER_MARK;
+    header.width = width;
+    header.height = height;
+    header.octaves = world.noise->getOctaves();
+    header.seed = world.noise->getSeed();
+    header.hash = world.noise->getHash();
+    header.a = world.a;
+    header.b = world.b;
+    header.c = world.c;
+    header.adjust = adjust;
+    header.riverCount = world.getRiverCount();
+    header.tileStride = (width + 1) / 2;
+    header.heightOffset = alignPage(sizeof(header));
+    header.tileOffset = alignPage(header.heightOffset + (uint64_t) width * height * sizeof(float));
+    header.fileSize = header.tileOffset + (uint64_t) header.tileStride * height;
+
+    std::ofstream file(path.c_str(), std::ios::binary);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    pad(file, header.heightOffset);
+    const Grid<float> &heightmap = world.getHeightmap();
+    file.write(reinterpret_cast<const char *>(heightmap.data()),
+               (std::streamsize) width * height * sizeof(float));
+    pad(file, header.tileOffset);
+    std::vector<char> row(header.tileStride);
+    for(unsigned y = 0; y < height; ++y)
+    {
+        const World::BIOME *tiles = world.tiles[y];
+        for(unsigned x = 0; x < width; x += 2)
+            row[x / 2] = tiles[x] | (x + 1 < width ? tiles[x + 1] << 4 : 0);
+        file.write(row.data(), row.size());
+    }
+    return file.good();
+}
+
+bool WorldFile::open(const std::string &path)
+{
+    close();
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(handle == INVALID_HANDLE_VALUE)
+        return false;
+    file = handle;
+    LARGE_INTEGER fileSize;
+    if(!GetFileSizeEx(handle, &fileSize) || fileSize.QuadPart < (LONGLONG) sizeof(WorldFileHeader))
+    {
+        close();
+        return false;
+    }
+    size = (size_t) fileSize.QuadPart;
+    mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(mapping)
+        data = static_cast<const uint8_t *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+    struct stat status;
+    if(fstat(fd, &status) == 0 && status.st_size >= (off_t) sizeof(WorldFileHeader))
+    {
+        size = status.st_size;
+        void *address = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if(address != MAP_FAILED)
+            data = static_cast<const uint8_t *>(address);
+    }
+    // the mapping keeps the file open
+    ::close(fd);
+#endif
+    if(!data)
+    {
+        close();
+        return false;
+    }
+    const WorldFileHeader &header = getHeader();
+    // World is limited to fewer than 2^32 - 1 tiles
+    uint64_t tiles = (uint64_t) header.width * header.height;
+    // sections are checked against the space left after their offset, as
+    // the offset plus the length overflows with a large enough offset
+    bool valid = memcmp(header.magic, MAGIC, 4) == 0 && header.version == VERSION &&
+                 header.byteOrder == ORDER_MARK && tiles > 0 && tiles < ~0u &&
+                 header.tileStride >= (header.width + 1) / 2 && header.fileSize == size &&
+                 header.heightOffset >= sizeof(WorldFileHeader) &&
+                 header.heightOffset % sizeof(float) == 0 && header.heightOffset <= size &&
+                 tiles <= (size - header.heightOffset) / sizeof(float) &&
+                 header.tileOffset <= size &&
+                 header.height <= (size - header.tileOffset) / header.tileStride;
+    if(!valid)
+        close();
+    return valid;
+}
+
+void WorldFile::close()
+{
+#ifdef _WIN32
+    if(data)
+        UnmapViewOfFile(data);
+    if(mapping)
+        CloseHandle(mapping);
+    if(file)
+        CloseHandle(file);
+    mapping = file = nullptr;
+#else
+    if(data)
+        munmap(const_cast<uint8_t *>(data), size);
+#endif
+    data = nullptr;
+    size = 0;
+}
+
+void WorldFile::getTiles(unsigned y, World::BIOME *out) const
+{
+    const WorldFileHeader &header = getHeader();
+    const uint8_t *row = data + header.tileOffset + (size_t) y * header.tileStride;
+    for(unsigned x = 0; x + 1 < header.width; x += 2)
+    {
+        out[x] = toBiome(row[x / 2] & 15);
+        out[x + 1] = toBiome(row[x / 2] >> 4);
+    }
+    if(header.width % 2)
+        out[header.width - 1] = toBiome(row[header.width / 2] & 15);
+}
@@ -0,0 +1,113 @@
+#ifndef WORLDFILE_H
+#define WORLDFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include "World.h"
+
+// start of a world file; the heights and the tiles follow at page aligned
+// offsets, so a mapped file is read in place without any parsing
+struct WorldFileHeader
+{
+    char magic[4];
+    uint32_t version;
+    // written as 0x01020304, anything else was written with another byte order
+    uint32_t byteOrder;
+    uint32_t width, height;
+    uint32_t octaves;
+    uint64_t seed;
+    uint32_t hash;
+    float a, b, c;
+    uint32_t adjust;
+    uint32_t riverCount;
+    // width floats per row
+    uint64_t heightOffset;
+    // four bits per tile, even columns in the low half of a byte, rows of
+    // tileStride bytes; rivers are tiles of World::RIVER
+    uint64_t tileOffset;
+    uint32_t tileStride;
+    uint32_t reserved;
+    uint64_t fileSize;
+};
+
+// writes world, which was generated with adjust, to path
+bool saveWorld(const World &world, bool adjust, const std::string &path);
+
+// read only view of a world file mapped into memory; the system reads the
+// pages of the file as they are touched
+class WorldFile
+{
+public:
+    static const char MAGIC[4];
+    static const uint32_t VERSION;
+
+    WorldFile() {}
+
+    ~WorldFile()
+    {
+        close();
+    }
+
+    // false when the file cannot be mapped, is not a world file, has
+    // another version or byte order or its sections do not fit in it;
+    // checks only the header, the tiles are checked as they are read
+    bool open(const std::string &path);
+    void close();
+
+    bool isOpen() const
+    {
+        return data != nullptr;
+    }
+
+    const WorldFileHeader &getHeader() const
+    {
+        return *reinterpret_cast<const WorldFileHeader *>(data);
+    }
+
+    unsigned getWidth() const
+    {
+        return getHeader().width;
+    }
+
+    unsigned getHeight() const
+    {
+        return getHeader().height;
+    }
+
+    // row y of the heightmap
+    const float *getHeights(unsigned y) const
+    {
+        return reinterpret_cast<const float *>(data + getHeader().heightOffset) +
+               (size_t) y * getHeader().width;
+    }
+
+    // a tile past World::RIVER, which only a corrupt file has, reads as
+    // World::RIVER
+    World::BIOME getTile(unsigned x, unsigned y) const
+    {
+        const WorldFileHeader &header = getHeader();
+        uint8_t pair = data[header.tileOffset + (size_t) y * header.tileStride + x / 2];
+        return toBiome(x % 2 ? pair >> 4 : pair & 15);
+    }
+
+    // unpacks row y of the tiles into out, reading them like getTile()
+    void getTiles(unsigned y, World::BIOME *out) const;
+private:
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void *file = nullptr, *mapping = nullptr;
+#endif
+
+    // a tile of four bits, of which only 0 to World::RIVER are biomes
+    static World::BIOME toBiome(unsigned nibble)
+    {
+        return (World::BIOME) (nibble > World::RIVER ? World::RIVER : nibble);
+    }
+
+    WorldFile(const WorldFile &) = delete;
+    WorldFile &operator=(const WorldFile &) = delete;
+};
+
+#endif // WORLDFILE_H
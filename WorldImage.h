@@ -0,0 +1,113 @@
+#ifndef WORLDIMAGE_H
+#define WORLDIMAGE_H
+
+#include <SFML/Graphics.hpp>
+#include <string.h>
+#include <utility>
+#include <vector>
+#include "World.h"
+
+// draws the biomes of a world into a texture through an RGBA buffer;
+// only rows whose tiles changed since they were last drawn are converted
+// and uploaded
+class WorldRenderer
+{
+private:
+    unsigned width = 0, height = 0;
+    // tiles the pixels currently show
+    Grid<World::BIOME> shown;
+    // one RGBA pixel per tile, in the byte order the texture expects
+    std::vector<uint32_t> pixels;
+    uint32_t colors[World::RIVER + 1];
+    // rows [first, second) converted but not uploaded yet
+    std::vector<std::pair<unsigned, unsigned>> dirty;
+    bool resized = false;
+
+    void markDirty(unsigned y)
+    {
+        if(!dirty.empty() && dirty.back().second == y)
+            ++dirty.back().second;
+        else
+            dirty.push_back(std::make_pair(y, y + 1));
+    }
+public:
+    WorldRenderer() : shown(0, 0)
+    {
+        for(unsigned i = 0; i <= World::RIVER; ++i)
+        {
+            const uint8_t rgba[4] = {World::COLORS[i][0], World::COLORS[i][1],
+                                     World::COLORS[i][2], 255};
+            memcpy(&colors[i], rgba, 4);
+        }
+    }
+
+    // converts the rows of w that differ from the drawn ones and returns
+    // how many there were
+    unsigned render(const World &w)
+    {
+        bool all = false;
+        if(w.getWidth() != width || w.getHeight() != height)
+        {
+            width = w.getWidth();
+            height = w.getHeight();
+            shown.resize(width, height);
+            pixels.resize((size_t) width * height);
+            dirty.clear();
+            resized = all = true;
+        }
+        unsigned count = 0;
+        for(unsigned y = 0; y < height; ++y)
+        {
+            const World::BIOME *tiles = w.tiles[y];
+            if(!all && memcmp(shown[y], tiles, width) == 0)
+                continue;
+            memcpy(shown[y], tiles, width);
+            uint32_t *row = &pixels[(size_t) y * width];
+            for(unsigned x = 0; x < width; ++x)
+                row[x] = colors[tiles[x]];
+            markDirty(y);
+            ++count;
+        }
+        return count;
+    }
+
+    // uploads the rows converted since the last upload, creating the
+    // texture when the world size changed
+    void upload(sf::Texture &texture)
+    {
+        const sf::Uint8 *data = reinterpret_cast<const sf::Uint8 *>(pixels.data());
+        if(resized)
+        {
+            texture.create(width, height);
+            resized = false;
+        }
+        for(const auto &rows : dirty)
+            texture.update(data + (size_t) rows.first * width * 4, width,
+                           rows.second - rows.first, 0, rows.first);
+        dirty.clear();
+    }
+
+    // converts and uploads everything on the next render and upload
+    void invalidate()
+    {
+        width = height = 0;
+    }
+
+    // RGBA bytes, width * height * 4 of them
+    const sf::Uint8 *getPixels() const
+    {
+        return reinterpret_cast<const sf::Uint8 *>(pixels.data());
+    }
+
+    unsigned getWidth() const
+    {
+        return width;
+    }
+
+    unsigned getHeight() const
+    {
+        return height;
+    }
+};
+
+#endif // WORLDIMAGE_H
@@ -0,0 +1,608 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "World.h"
+#include "ChunkedWorld.h"
+#include "WorldFile.h"
+#include "SeedSweep.h"
+#include "RegionMap.h"
+#include "DistanceMap.h"
+#include "BiomeTable.h"
+#ifdef PERLIN_BENCH_SFML
+#include "WorldImage.h"
+#endif
+
+// keeps the compiler from dropping noise samples nobody reads
+volatile float sink;
+
+struct Options
+{
+    std::vector<unsigned> sizes = {256, 512, 1024};
+    unsigned long seed = 1234;
+    unsigned octaves = 5;
+    unsigned threads = 1;
+    double minTime = 0.5;
+    std::string filter;
+};
+
+struct Result
+{
+    std::string name;
+    unsigned long iterations;
+    double realTime, cpuTime;
+    double items;
+};
+
+// wall and processor time of one measured interval
+class Timer
+{
+private:
+    std::chrono::steady_clock::time_point start;
+    clock_t cpuStart;
+public:
+    double real = 0.0, cpu = 0.0;
+
+    void resume()
+    {
+        start = std::chrono::steady_clock::now();
+        cpuStart = clock();
+    }
+
+    void pause()
+    {
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        real += elapsed.count();
+        cpu += (double) (clock() - cpuStart) / CLOCKS_PER_SEC;
+    }
+};
+
+// prints results in the JSON layout of Google Benchmark, so runs of two
+// commits can be compared with its tools/compare.py
+class Suite
+{
+private:
+    Options options;
+    std::vector<Result> results;
+
+    void add(const std::string &name, unsigned long iterations,
+             const Timer &timer, double itemsPerIteration)
+    {
+        Result result;
+        result.name = name;
+        result.iterations = iterations;
+        result.realTime = timer.real / iterations;
+        result.cpuTime = timer.cpu / iterations;
+        result.items = itemsPerIteration;
+        results.push_back(result);
+        std::cerr << name << ": " << result.realTime * 1e6 << " us x " << iterations << "\n";
+    }
+
+    bool selected(const std::string &name) const
+    {
+        return name.find(options.filter) != std::string::npos;
+    }
+
+    static std::string sizeName(unsigned size)
+    {
+        return "/size:" + std::to_string(size);
+    }
+
+public:
+    Suite(const Options &_options) : options(_options) {}
+
+    // repeats step until minTime of measured time is collected; step
+    // resumes and pauses the timer around the part it wants measured
+    template<class F>
+    void run(const std::string &name, double itemsPerIteration, F step)
+    {
+        if(!selected(name))
+            return;
+        Timer timer;
+        unsigned long iterations = 0;
+        while(timer.real < options.minTime)
+        {
+            step(timer);
+            ++iterations;
+        }
+        add(name, iterations, timer, itemsPerIteration);
+    }
+
+    // the permutation table hash is reported with a _permutation suffix
+    void noise()
+    {
+        noise(PerlinNoise2D::POLYNOMIAL, "");
+        noise(PerlinNoise2D::PERMUTATION, "_permutation");
+    }
+
+    void noise(PerlinNoise2D::HASH hash, const std::string &hashName)
+    {
+        const unsigned side = 256;
+        std::vector<float> block(side * side);
+        for(unsigned octaves = 1; octaves <= PerlinNoise2D::MAX_OCTAVES; ++octaves)
+        {
+            PerlinNoise2D noise(octaves, options.seed, hash);
+            std::string suffix = hashName + "/octaves:" + std::to_string(octaves);
+            run("noise_get" + suffix, side * side, [&](Timer &timer)
+            {
+                float total = 0.0f;
+                timer.resume();
+                for(unsigned y = 0; y < side; ++y)
+                    for(unsigned x = 0; x < side; ++x)
+                        total += noise.get(x * 0.125f, y * 0.125f);
+                timer.pause();
+                sink = total;
+            });
+            run("noise_get_block" + suffix, side * side, [&](Timer &timer)
+            {
+                timer.resume();
+                noise.getBlock(block.data(), side, side, side, 0, 0, 0.125f);
+                timer.pause();
+                sink = block[side];
+            });
+        }
+    }
+
+    void world(unsigned size)
+    {
+        ThreadPool pool(options.threads);
+        PerlinNoise2D noise(options.octaves, options.seed);
+        World world(size, size);
+        world.noise = &noise;
+        world.pool = &pool;
+        double tiles = (double) size * size;
+
+        run("generate" + sizeName(size), tiles, [&](Timer &timer)
+        {
+            world.invalidate();
+            timer.resume();
+            world.generate(true);
+            timer.pause();
+        });
+        // the same world at a quarter of the resolution, items are tiles of
+        // the full world
+        World preview(size, size, 4);
+        preview.noise = &noise;
+        preview.pool = &pool;
+        run("generate_preview" + sizeName(size), tiles, [&](Timer &timer)
+        {
+            preview.invalidate();
+            timer.resume();
+            preview.generate(true);
+            timer.pause();
+        });
+        run("terrain" + sizeName(size), tiles, [&](Timer &timer)
+        {
+            world.invalidate();
+            timer.resume();
+            world.generateTerrain();
+            timer.pause();
+        });
+        // what a mouse wheel step in the viewer costs: only the falloff
+        // changed, so the cached noise fields are reused
+        run("terrain_retune" + sizeName(size), tiles, [&](Timer &timer)
+        {
+            world.a = world.a == 0.1f ? 0.15f : 0.1f;
+            timer.resume();
+            world.generateTerrain();
+            timer.pause();
+        });
+        world.a = 0.1f;
+        // a retune with a warped height noise, which is sampled anew every
+        // time while the warp fields come from the cache
+        world.warp = 20.0f;
+        world.generateTerrain();
+        run("terrain_warp_retune" + sizeName(size), tiles, [&](Timer &timer)
+        {
+            world.a = world.a == 0.1f ? 0.15f : 0.1f;
+            timer.resume();
+            world.generateTerrain();
+            timer.pause();
+        });
+        world.warp = 0.0f;
+        world.a = 0.1f;
+        world.generateTerrain();
+        // the default biome rules on the heights of the last terrain, with
+        // the mirrored rows standing in for the moisture
+        const Grid<float> &heights = world.getHeightmap();
+        Grid<World::BIOME> classified(size, size);
+        run("biome_table" + sizeName(size), tiles, [&](Timer &timer)
+        {
+            const BiomeTable &table = BiomeTable::getDefault();
+            timer.resume();
+            for(unsigned y = 0; y < size; ++y)
+                table.classify(heights[y], heights[size - 1 - y], classified[y], size);
+            timer.pause();
+            sink = classified[size / 2][size / 2];
+        });
+        // what a tuning run over the octave counts of one seed costs, every
+        // step computes only the octave it adds
+        run("terrain_octave_walk" + sizeName(size), tiles * PerlinNoise2D::MAX_OCTAVES,
+            [&](Timer &timer)
+        {
+            world.invalidate();
+            timer.resume();
+            for(unsigned octaves = 1; octaves <= PerlinNoise2D::MAX_OCTAVES; ++octaves)
+            {
+                noise.setOctaves(octaves);
+                world.generateTerrain();
+            }
+            timer.pause();
+        });
+        noise.setOctaves(options.octaves);
+        adjustPasses(world, size);
+        rivers(world, size);
+        chunks(size);
+        worldFile(world, size);
+        sweep(size);
+        erosion(world, size);
+        regions(world, size);
+        distances(world, size);
+#ifdef PERLIN_BENCH_SFML
+        // conversion to RGBA of every row, and of none when nothing changed
+        WorldRenderer renderer;
+        run("render" + sizeName(size), tiles, [&](Timer &timer)
+        {
+            renderer.invalidate();
+            timer.resume();
+            renderer.render(world);
+            timer.pause();
+        });
+        run("render_unchanged" + sizeName(size), tiles, [&](Timer &timer)
+        {
+            timer.resume();
+            renderer.render(world);
+            timer.pause();
+        });
+#endif
+    }
+
+    // erosion of the heightmap of world, restored from a copy before
+    // every run, items are tiles
+    void erosion(World &world, unsigned size)
+    {
+        ThreadPool pool(options.threads);
+        Erosion erosion;
+        Grid<float> original = world.getHeightmap();
+        Grid<float> heights = original;
+        run("erosion" + sizeName(size), (double) size * size, [&](Timer &timer)
+        {
+            heights = original;
+            timer.resume();
+            erosion.run(heights, options.seed, &pool);
+            timer.pause();
+        });
+    }
+
+    // building the region map of world, items are tiles, and queries on
+    // it from the same pseudo random points every run, items are queries
+    void regions(World &world, unsigned size)
+    {
+        // the other benchmarks leave the tiles at some stage
+        world.generate(true);
+        RegionMap map;
+        run("region_map" + sizeName(size), (double) size * size, [&](Timer &timer)
+        {
+            timer.resume();
+            map.build(world);
+            timer.pause();
+        });
+        const unsigned queries = 1000;
+        std::vector<unsigned> points(2 * queries);
+        uint32_t state = 1;
+        for(auto &point : points)
+        {
+            state = state * 1664525u + 1013904223u;
+            point = (state >> 8) % size;
+        }
+        run("region_nearest_river" + sizeName(size), queries, [&](Timer &timer)
+        {
+            unsigned x = 0, y = 0, sum = 0;
+            timer.resume();
+            for(unsigned i = 0; i < queries; ++i)
+            {
+                map.findNearest(World::RIVER, points[2 * i], points[2 * i + 1], x, y);
+                sum += x + y;
+            }
+            timer.pause();
+            sink = sum;
+        });
+        std::vector<unsigned> found;
+        run("region_rect_64" + sizeName(size), queries, [&](Timer &timer)
+        {
+            size_t sum = 0;
+            timer.resume();
+            for(unsigned i = 0; i < queries; ++i)
+            {
+                map.findRegions(World::GRASSLAND, points[2 * i], points[2 * i + 1],
+                                points[2 * i] + 64, points[2 * i + 1] + 64, found);
+                sum += found.size();
+            }
+            timer.pause();
+            sink = sum;
+        });
+    }
+
+    // all distance fields and the coastlines of world, then the water
+    // field alone, items are tiles; regions() left the world complete
+    void distances(World &world, unsigned size)
+    {
+        ThreadPool pool(options.threads);
+        DistanceMap map;
+        run("distance_map" + sizeName(size), (double) size * size, [&](Timer &timer)
+        {
+            timer.resume();
+            map.build(world, &pool);
+            timer.pause();
+        });
+        map.fields = 1 << DistanceMap::WATER;
+        run("distance_map_water" + sizeName(size), (double) size * size, [&](Timer &timer)
+        {
+            timer.resume();
+            map.build(world, &pool);
+            timer.pause();
+        });
+    }
+
+    // worlds per second of a seed sweep, items are worlds
+    void sweep(unsigned size)
+    {
+        ThreadPool pool(options.threads);
+        SeedSweep sweep(size, size, &pool);
+        WorldSettings settings;
+        settings.octaves = options.octaves;
+        const unsigned count = 8;
+        unsigned long seed = options.seed;
+        run("sweep" + sizeName(size), count, [&](Timer &timer)
+        {
+            timer.resume();
+            sweep.run(seed, count, settings);
+            timer.pause();
+            seed += count;
+        });
+    }
+
+    // writing a world file, and opening it with a read of one tile, which
+    // should not depend on the size
+    void worldFile(World &world, unsigned size)
+    {
+        const std::string path = "perlin-bench.world";
+        double tiles = (double) size * size;
+        run("world_file_save" + sizeName(size), tiles, [&](Timer &timer)
+        {
+            timer.resume();
+            saveWorld(world, true, path);
+            timer.pause();
+        });
+        run("world_file_open" + sizeName(size), 1, [&](Timer &timer)
+        {
+            WorldFile file;
+            timer.resume();
+            file.open(path);
+            sink = file.getTile(size / 2, size / 2);
+            file.close();
+            timer.pause();
+        });
+        remove(path.c_str());
+    }
+
+    // generation of one chunk next to the origin and one far away, which
+    // should cost the same; chunk_cached is a hit of the chunk cache
+    void chunks(unsigned size)
+    {
+        ThreadPool pool(options.threads);
+        PerlinNoise2D noise(options.octaves, options.seed);
+        ChunkedWorld world(&noise, size);
+        world.pool = &pool;
+        Chunk chunk(size);
+        double tiles = (double) size * size;
+        const long far = 1L << 24;
+
+        run("chunk/origin" + sizeName(size), tiles, [&](Timer &timer)
+        {
+            timer.resume();
+            world.generate(chunk, -1, 0);
+            timer.pause();
+        });
+        run("chunk/far" + sizeName(size), tiles, [&](Timer &timer)
+        {
+            timer.resume();
+            world.generate(chunk, far, -far);
+            timer.pause();
+        });
+        run("chunk_cached" + sizeName(size), 1000, [&](Timer &timer)
+        {
+            timer.resume();
+            for(unsigned i = 0; i < 1000; ++i)
+                sink = world.getChunk(i & 3, 0)->heightmap[0][0];
+            timer.pause();
+        });
+    }
+
+    // times every adjustBiome call of adjustBiomes() on its own input
+    void adjustPasses(World &world, unsigned size)
+    {
+        std::vector<std::string> passes;
+        for(unsigned b = World::OCEAN; b <= World::SNOW; ++b)
+            passes.push_back(std::to_string(passes.size()) + ":" + World::BIOME_NAMES[b]);
+        passes.push_back(std::to_string(passes.size()) + ":coast");
+        passes.push_back(std::to_string(passes.size()) + ":ocean_special");
+        std::vector<Timer> timers(passes.size());
+        std::string prefix = "adjust_biome/pass:";
+        bool any = false;
+        for(auto &pass : passes)
+            any = any || selected(prefix + pass + sizeName(size));
+        if(!any)
+            return;
+        unsigned long iterations = 0;
+        Timer total;
+        while(total.real < options.minTime)
+        {
+            world.generateTerrain();
+            total.resume();
+            unsigned p = 0;
+            for(unsigned b = World::OCEAN; b <= World::SNOW; ++b, ++p)
+            {
+                timers[p].resume();
+                world.adjustBiome(b);
+                timers[p].pause();
+            }
+            world.restoreCoast();
+            timers[p].resume();
+            world.adjustBiome(World::COAST);
+            timers[p++].pause();
+            timers[p].resume();
+            world.adjustBiome(World::OCEAN, true);
+            timers[p].pause();
+            total.pause();
+            ++iterations;
+        }
+        for(unsigned p = 0; p < passes.size(); ++p)
+            if(selected(prefix + passes[p] + sizeName(size)))
+                add(prefix + passes[p] + sizeName(size), iterations, timers[p],
+                    (double) size * size);
+    }
+
+    // times each river of a fixed seed after the adjusted terrain; the
+    // adjusted tiles are restored from a copy before every iteration
+    void rivers(World &world, unsigned size)
+    {
+        world.generateTerrain();
+        world.adjustBiomes();
+        Grid<World::BIOME> adjusted = world.tiles;
+        unsigned count = world.getRiverCount();
+        std::vector<Timer> timers(count);
+        std::string prefix = "river/index:";
+        bool any = false;
+        for(unsigned i = 0; i < count; ++i)
+            any = any || selected(prefix + std::to_string(i) + sizeName(size));
+        if(!any)
+            return;
+        unsigned long iterations = 0;
+        Timer total;
+        while(total.real < options.minTime)
+        {
+            world.tiles = adjusted;
+            total.resume();
+            for(unsigned i = 0; i < count; ++i)
+            {
+                timers[i].resume();
+                world.generateRiver(i);
+                timers[i].pause();
+            }
+            total.pause();
+            ++iterations;
+        }
+        for(unsigned i = 0; i < count; ++i)
+            if(selected(prefix + std::to_string(i) + sizeName(size)))
+                add(prefix + std::to_string(i) + sizeName(size), iterations, timers[i], 1);
+    }
+
+    void print(std::ostream &out, const char *executable) const
+    {
+        time_t now = time(NULL);
+        char date[64];
+        strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+        out << "{\n  \"context\": {\n";
+        out << "    \"date\": \"" << date << "\",\n";
+        out << "    \"executable\": \"" << executable << "\",\n";
+        out << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+        out << "    \"threads\": " << options.threads << ",\n";
+        out << "    \"seed\": " << options.seed << ",\n";
+#ifdef __AVX2__
+        out << "    \"simd\": \"avx2\",\n";
+#elif defined(PERLIN_SIMD)
+        out << "    \"simd\": \"sse2\",\n";
+#else
+        out << "    \"simd\": \"none\",\n";
+#endif
+#ifdef NDEBUG
+        out << "    \"library_build_type\": \"release\"\n";
+#else
+        out << "    \"library_build_type\": \"debug\"\n";
+#endif
+        out << "  },\n  \"benchmarks\": [";
+        for(unsigned i = 0; i < results.size(); ++i)
+        {
+            const Result &r = results[i];
+            out << (i ? ",\n" : "\n") << "    {\n";
+            out << "      \"name\": \"" << r.name << "\",\n";
+            out << "      \"run_name\": \"" << r.name << "\",\n";
+            out << "      \"run_type\": \"iteration\",\n";
+            out << "      \"iterations\": " << r.iterations << ",\n";
+            out << "      \"real_time\": " << r.realTime * 1e9 << ",\n";
+            out << "      \"cpu_time\": " << r.cpuTime * 1e9 << ",\n";
+            out << "      \"time_unit\": \"ns\",\n";
+            out << "      \"items_per_second\": " << (r.realTime > 0 ? r.items / r.realTime : 0) << "\n";
+            out << "    }";
+        }
+        out << "\n  ]\n}\n";
+    }
+};
+
+void usage()
+{
+    std::cerr <<
+        "usage: perlin-bench [options]\n"
+        "  --sizes A,B,..  square map sizes (default: 256,512,1024)\n"
+        "  --seed N        world seed (default: 1234)\n"
+        "  --octaves N     octaves of the world noise (default: 5)\n"
+        "  --threads N     generation threads (default: 1)\n"
+        "  --min-time S    measured seconds per benchmark (default: 0.5)\n"
+        "  --filter TEXT   only run benchmarks whose name contains TEXT\n"
+        "JSON results go to stdout, progress to stderr\n";
+}
+
+bool parse(int argc, char **argv, Options &options)
+{
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if(i + 1 >= argc)
+            return false;
+        if(arg == "--sizes")
+        {
+            options.sizes.clear();
+            std::stringstream list(argv[++i]);
+            std::string size;
+            while(std::getline(list, size, ','))
+                options.sizes.push_back(atoi(size.c_str()));
+        }
+        else if(arg == "--seed")
+            options.seed = strtoul(argv[++i], nullptr, 10);
+        else if(arg == "--octaves")
+            options.octaves = atoi(argv[++i]);
+        else if(arg == "--threads")
+            options.threads = atoi(argv[++i]);
+        else if(arg == "--min-time")
+            options.minTime = atof(argv[++i]);
+        else if(arg == "--filter")
+            options.filter = argv[++i];
+        else
+            return false;
+    }
+    for(auto size : options.sizes)
+        if(size == 0)
+            return false;
+    return options.octaves >= 1 && options.octaves <= PerlinNoise2D::MAX_OCTAVES;
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if(!parse(argc, argv, options))
+    {
+        usage();
+        return 1;
+    }
+    Suite suite(options);
+    suite.noise();
+    for(auto size : options.sizes)
+        suite.world(size);
+    suite.print(std::cout, argv[0]);
+    return 0;
+}
@@ -0,0 +1,1010 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <set>
+#include <stdexcept>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <math.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "World.h"
+#include "RiverRouter.h"
+#include "PoissonDisk.h"
+#include "WorldFile.h"
+#include "ChunkedWorld.h"
+#include "SeedSweep.h"
+#include "RegionMap.h"
+#include "DistanceMap.h"
+#include "BiomeTable.h"
+#include "TerrainGraph.h"
+
+// the invariants the optimized paths promise, each checked against a
+// plain reference: batch noise against get(), results that do not depend
+// on the thread count or on what was cached, the biome table against the
+// comparisons it replaced, and distances and region queries against
+// brute force. Prints one line per check and fails when any check fails
+class Checks
+{
+private:
+    std::string filter;
+    unsigned failed = 0;
+
+    bool selected(const std::string &name) const
+    {
+        return name.find(filter) != std::string::npos;
+    }
+
+    // bitwise, so NaN compares equal to itself and -0 differs from 0
+    template<class T>
+    static bool same(const T *first, const T *second, size_t count)
+    {
+        return memcmp(first, second, count * sizeof(T)) == 0;
+    }
+
+    static bool sameWorld(const World &first, const World &second)
+    {
+        size_t tiles = (size_t) first.getWidth() * first.getHeight();
+        return first.getWidth() == second.getWidth() && first.getHeight() == second.getHeight() &&
+               same(first.tiles.data(), second.tiles.data(), tiles) &&
+               same(first.getHeightmap().data(), second.getHeightmap().data(), tiles) &&
+               first.getRiverCount() == second.getRiverCount();
+    }
+
+    // everything a world is generated from besides its size
+    struct Recipe
+    {
+        unsigned long seed = 11;
+        PerlinNoise2D::HASH hash = PerlinNoise2D::POLYNOMIAL;
+        unsigned octaves = 5;
+        float a = 0.1f, b = 0.55f, c = 1.4f, warp = 0.0f;
+        bool erode = false;
+        const BiomeTable *biomes = nullptr;
+    };
+
+    // a world generated from scratch with recipe
+    static void generateFresh(World &world, const Recipe &recipe, bool cacheFields,
+                              ThreadPool *pool)
+    {
+        PerlinNoise2D noise(recipe.octaves, recipe.seed, recipe.hash);
+        Erosion erosion;
+        world.noise = &noise;
+        world.pool = pool;
+        world.cacheFields = cacheFields;
+        world.a = recipe.a;
+        world.b = recipe.b;
+        world.c = recipe.c;
+        world.warp = recipe.warp;
+        world.biomes = recipe.biomes;
+        world.erosion = recipe.erode ? &erosion : nullptr;
+        world.generate(true);
+        world.noise = nullptr;
+        world.erosion = nullptr;
+    }
+
+    // one pass of the flood fill adjustBiome() used before its regions
+    // were labelled by union-find: each region of b is collected with
+    // sets and reassigned before the next one is looked at
+    static void floodFillBiome(World &world, unsigned b, bool special)
+    {
+        const unsigned biomeCount = World::COAST + 1;
+        unsigned width = world.getWidth(), height = world.getHeight();
+        std::vector<bool> checked((size_t) width * height, false);
+        for(unsigned y = 0; y < height; ++y)
+            for(unsigned x = 0; x < width; ++x)
+            {
+                if(world.tiles[y][x] != b || checked[(size_t) y * width + x])
+                    continue;
+                bool touchesEdge = false;
+                std::set<size_t> closed, neighbours;
+                std::vector<size_t> opened(1, (size_t) y * width + x);
+                checked[opened[0]] = true;
+                while(!opened.empty())
+                {
+                    size_t index = opened.back();
+                    opened.pop_back();
+                    closed.insert(index);
+                    unsigned tx = index % width, ty = index / width;
+                    if(tx == 0 || ty == 0 || tx == width - 1 || ty == height - 1)
+                        touchesEdge = true;
+                    for(int dy = -1; dy <= 1; ++dy)
+                        for(int dx = -1; dx <= 1; ++dx)
+                        {
+                            long nx = (long) tx + dx, ny = (long) ty + dy;
+                            bool diagonal = dx != 0 && dy != 0;
+                            if((dx == 0 && dy == 0) || nx < 0 || ny < 0 || nx >= width ||
+                               ny >= height)
+                                continue;
+                            size_t next = (size_t) ny * width + nx;
+                            if(world.tiles[ny][nx] != b)
+                            {
+                                if(!diagonal)
+                                    neighbours.insert(next);
+                            }
+                            else if((!diagonal || b == World::BEACH) && !checked[next])
+                            {
+                                checked[next] = true;
+                                opened.push_back(next);
+                            }
+                        }
+                }
+                unsigned newBiome;
+                if((b != World::OCEAN && closed.size() < 100) ||
+                   (b == World::OCEAN && closed.size() < 50) ||
+                   (b == World::OCEAN && special && closed.size() < 300))
+                {
+                    unsigned long neighbourCount[biomeCount] = {};
+                    for(size_t n : neighbours)
+                        ++neighbourCount[world.tiles.data()[n]];
+                    newBiome = 0;
+                    for(unsigned i = 1; i < biomeCount; ++i)
+                        if(neighbourCount[i] > neighbourCount[newBiome])
+                            newBiome = i;
+                }
+                else if(b == World::OCEAN && !touchesEdge && !special)
+                    newBiome = World::LAKE;
+                else
+                    continue;
+                for(size_t index : closed)
+                    world.tiles.data()[index] = (World::BIOME) newBiome;
+            }
+    }
+
+    // node id of graph at tile (x, y) of a full world of width x height,
+    // evaluated one node and one tile at a time
+    static float evaluate(const TerrainGraph &graph, unsigned id, const PerlinNoise2D &noise,
+                          long x, long y, unsigned width, unsigned height)
+    {
+        const TerrainGraph::Node &node = graph.getNodes()[id];
+        auto input = [&](unsigned i)
+        {
+            return evaluate(graph, i, noise, x, y, width, height);
+        };
+        switch(node.op)
+        {
+        case TerrainGraph::CONSTANT:
+            return node.value;
+        case TerrainGraph::NOISE:
+            if(node.first == TerrainGraph::NO_NODE)
+                return noise.get((float) (node.x + x) * node.scale, (float) (node.y + y) * node.scale);
+            else
+            {
+                float warpX = input(node.first), warpY = input(node.second);
+                return noise.get(((float) (node.x + x) + node.value * warpX) * node.scale,
+                                 ((float) (node.y + y) + node.value * warpY) * node.scale);
+            }
+        case TerrainGraph::FALLOFF:
+        {
+            float dx = 2.0f * (float) x / width - 1.0f;
+            float dy = 2.0f * (float) y / height - 1.0f;
+            float d2 = dx * dx + dy * dy;
+            return pow(d2, node.value);
+        }
+        case TerrainGraph::REMAP:
+            return World::remap(input(node.first));
+        case TerrainGraph::CURVE:
+        {
+            const float *points = &graph.getPoints()[node.firstPoint];
+            float value = input(node.first);
+            if(!(value > points[0]))
+                return points[1];
+            for(unsigned k = 1; k < node.pointCount; ++k)
+                if(value < points[2 * k])
+                {
+                    float t = (value - points[2 * k - 2]) / (points[2 * k] - points[2 * k - 2]);
+                    return points[2 * k - 1] + t * (points[2 * k + 1] - points[2 * k - 1]);
+                }
+            return points[2 * node.pointCount - 1];
+        }
+        case TerrainGraph::ADD:
+            return input(node.first) + input(node.second);
+        case TerrainGraph::SUBTRACT:
+            return input(node.first) - input(node.second);
+        case TerrainGraph::MULTIPLY:
+            return input(node.first) * input(node.second);
+        case TerrainGraph::MINIMUM:
+        {
+            float first = input(node.first), second = input(node.second);
+            return second < first ? second : first;
+        }
+        default:
+        {
+            float first = input(node.first), second = input(node.second);
+            return first < second ? second : first;
+        }
+        }
+    }
+
+    // the biomes of the hard coded comparisons the default rules replaced
+    static World::BIOME oldBiome(float height, float moisture)
+    {
+        if(height < -0.1f)
+            return World::OCEAN;
+        else if(height < 0.0f)
+            return World::COAST;
+        else if(height < 0.02f)
+            return moisture > -0.1f ? World::GRASSLAND : World::BEACH;
+        else if(height < 0.2f)
+            return moisture < -0.4 ? World::STEPPE : World::GRASSLAND;
+        else if(height < 0.3f)
+            return moisture > 0.0f ? World::FOREST : World::GRASSLAND;
+        else if(height < 0.4f)
+            return World::FOREST;
+        else if(height < 0.5f)
+            return World::MOUNTAINS;
+        else
+            return moisture < 0.1f ? World::MOUNTAINS : World::SNOW;
+    }
+
+    // splitmix64 in [-range, range)
+    static float randomValue(uint64_t &state, float range)
+    {
+        return (nextFloat(state) * 2.0f - 1.0f) * range;
+    }
+public:
+    Checks(const std::string &_filter) : filter(_filter) {}
+
+    unsigned getFailed() const
+    {
+        return failed;
+    }
+
+    // runs check, which returns an empty string when it passes and what
+    // went wrong otherwise
+    template<class F>
+    void run(const std::string &name, F check)
+    {
+        if(!selected(name))
+            return;
+        std::string error = check();
+        if(error.empty())
+            std::cout << "ok " << name << "\n";
+        else
+        {
+            std::cout << "FAIL " << name << ": " << error << "\n";
+            ++failed;
+        }
+    }
+
+    // getRow(), getOctaveSums() and getPoints() match get() bit for bit
+    // with every hash and octave count
+    void noise()
+    {
+        run("noise_batch_matches_get", []() -> std::string
+        {
+            const unsigned count = 203;
+            const long starts[] = {0, -517, 100003};
+            const long steps[] = {1, 3};
+            const float scales[] = {0.125f, 0.0625f};
+            std::vector<float> row(count), px(count), py(count);
+            std::vector<std::vector<float>> sums(PerlinNoise2D::MAX_OCTAVES,
+                                                 std::vector<float>(count));
+            std::vector<float *> sumRows;
+            for(auto &sum : sums)
+                sumRows.push_back(sum.data());
+            uint64_t state = 5;
+            for(auto hash : {PerlinNoise2D::POLYNOMIAL, PerlinNoise2D::PERMUTATION})
+                for(unsigned octaves = 1; octaves <= PerlinNoise2D::MAX_OCTAVES; ++octaves)
+                {
+                    PerlinNoise2D noise(octaves, 1234 + octaves, hash);
+                    std::ostringstream where;
+                    where << "hash " << hash << " octaves " << octaves;
+                    for(long x : starts)
+                        for(long step : steps)
+                            for(float scale : scales)
+                            {
+                                long y = x / 3 + 7;
+                                noise.getRow(row.data(), count, x, y, scale, step);
+                                noise.getOctaveSums(sumRows.data(), 0, count, x, y, scale, step);
+                                for(unsigned i = 0; i < count; ++i)
+                                {
+                                    float expected = noise.get((float) (x + (long) i * step) * scale,
+                                                               (float) y * scale);
+                                    float sum = sums[octaves - 1][i] / noise.getScale();
+                                    if(!same(&row[i], &expected, 1))
+                                        return "getRow differs from get, " + where.str();
+                                    if(!same(&sum, &expected, 1))
+                                        return "getOctaveSums differs from get, " + where.str();
+                                }
+                            }
+                    for(unsigned i = 0; i < count; ++i)
+                    {
+                        px[i] = randomValue(state, 3000.0f);
+                        py[i] = randomValue(state, 3000.0f);
+                    }
+                    noise.getPoints(px.data(), py.data(), row.data(), count);
+                    for(unsigned i = 0; i < count; ++i)
+                    {
+                        float expected = noise.get(px[i], py[i]);
+                        if(!same(&row[i], &expected, 1))
+                            return "getPoints differs from get, " + where.str();
+                    }
+                }
+            return "";
+        });
+    }
+
+    // the pool splits work into fixed bands and river batches, so worlds,
+    // chunks and sweeps come out the same with any number of threads
+    void threads()
+    {
+        run("world_independent_of_threads", []() -> std::string
+        {
+            ThreadPool pool2(2), pool5(5);
+            Recipe recipe;
+            for(unsigned step : {1u, 3u})
+                for(bool erode : {false, true})
+                {
+                    recipe.erode = erode;
+                    World single(300, 200, step), two(300, 200, step), five(300, 200, step);
+                    generateFresh(single, recipe, true, nullptr);
+                    generateFresh(two, recipe, true, &pool2);
+                    generateFresh(five, recipe, true, &pool5);
+                    if(!sameWorld(single, two) || !sameWorld(single, five))
+                        return "step " + std::to_string(step) + (erode ? " with erosion" : "");
+                }
+            return "";
+        });
+        run("chunks_independent_of_threads", []() -> std::string
+        {
+            ThreadPool pool(3);
+            PerlinNoise2D noise(5, 21);
+            ChunkedWorld single(&noise, 64), threaded(&noise, 64);
+            threaded.pool = &pool;
+            for(int64_t cy = -1; cy <= 1; ++cy)
+                for(int64_t cx = -2; cx <= 1; ++cx)
+                {
+                    auto first = single.getChunk(cx, cy), second = threaded.getChunk(cx, cy);
+                    if(!same(first->tiles.data(), second->tiles.data(), 64 * 64) ||
+                       !same(first->heightmap.data(), second->heightmap.data(), 64 * 64))
+                        return "chunk " + std::to_string(cx) + "," + std::to_string(cy);
+                }
+            return "";
+        });
+        run("sweep_independent_of_threads", []() -> std::string
+        {
+            ThreadPool pool(3);
+            WorldSettings settings;
+            SeedSweep single(160, 120, nullptr), threaded(160, 120, &pool);
+            std::vector<SweepResult> first = single.run(40, 7, settings);
+            std::vector<SweepResult> second = threaded.run(40, 7, settings);
+            for(unsigned i = 0; i < first.size(); ++i)
+                if(first[i].seed != second[i].seed || first[i].riverCount != second[i].riverCount ||
+                   first[i].lakeCount != second[i].lakeCount ||
+                   !same(&first[i].waterFactor, &second[i].waterFactor, 1) ||
+                   !same(first[i].histogram, second[i].histogram, World::RIVER + 1))
+                    return "seed " + std::to_string(first[i].seed);
+            return "";
+        });
+    }
+
+    // a world that reuses its cached fields while settings change is the
+    // world generated from scratch with the final settings
+    void incremental()
+    {
+        run("cached_generation_matches_fresh", []() -> std::string
+        {
+            BiomeTable rules;
+            if(!rules.parse("height from -1 ocean\nheight from 0 beach\nheight from 0.1 forest\n"
+                            "moisture above 0.2 snow\n"))
+                return "biome rules do not parse";
+            Erosion erosion;
+            World world(240, 180);
+            Recipe recipe;
+            std::unique_ptr<PerlinNoise2D> noise;
+            // each step changes one setting of the last one
+            for(unsigned step = 0; step < 10; ++step)
+            {
+                switch(step)
+                {
+                case 1: recipe.a = 0.2f; break;
+                case 2: recipe.c = 2.0f; break;
+                case 3: recipe.octaves = 3; break;
+                case 4: recipe.octaves = 7; break;
+                case 5: recipe.warp = 12.0f; break;
+                case 6: recipe.biomes = &rules; break;
+                case 7: recipe.warp = 0.0f; recipe.hash = PerlinNoise2D::PERMUTATION; break;
+                case 8: recipe.seed = 12; break;
+                case 9: recipe.erode = true; break;
+                }
+                // a new noise only for a new seed or hash, like the viewer
+                if(!noise || noise->getSeed() != recipe.seed || noise->getHash() != recipe.hash)
+                    noise.reset(new PerlinNoise2D(recipe.octaves, recipe.seed, recipe.hash));
+                else
+                    noise->setOctaves(recipe.octaves);
+                world.noise = noise.get();
+                world.a = recipe.a;
+                world.b = recipe.b;
+                world.c = recipe.c;
+                world.warp = recipe.warp;
+                world.biomes = recipe.biomes;
+                world.erosion = recipe.erode ? &erosion : nullptr;
+                world.generate(true);
+                World fresh(240, 180), uncached(240, 180);
+                generateFresh(fresh, recipe, true, nullptr);
+                generateFresh(uncached, recipe, false, nullptr);
+                if(!sameWorld(world, fresh))
+                    return "cached world differs at step " + std::to_string(step);
+                if(!sameWorld(world, uncached))
+                    return "world without cache differs at step " + std::to_string(step);
+            }
+            return "";
+        });
+    }
+
+    // the default biome rules give what the old comparisons gave, at and
+    // around every threshold and for random heights and moistures
+    void biomes()
+    {
+        run("default_biome_table_matches_comparisons", []() -> std::string
+        {
+            const BiomeTable &table = BiomeTable::getDefault();
+            std::vector<float> heights = {-0.1f, 0.0f, 0.02f, 0.2f, 0.3f, 0.4f, 0.5f, -1.0f, 1.0f};
+            std::vector<float> moistures = {-0.1f, -0.4f, 0.0f, 0.1f, -1.0f, 1.0f};
+            // a few floats on both sides of every threshold
+            for(auto *values : {&heights, &moistures})
+            {
+                std::vector<float> around;
+                for(float value : *values)
+                {
+                    float below = value, above = value;
+                    around.push_back(value);
+                    for(unsigned i = 0; i < 3; ++i)
+                    {
+                        below = nextafterf(below, -INFINITY);
+                        above = nextafterf(above, INFINITY);
+                        around.push_back(below);
+                        around.push_back(above);
+                    }
+                }
+                values->swap(around);
+            }
+            uint64_t state = 9;
+            for(unsigned i = 0; i < 100000; ++i)
+            {
+                heights.push_back(randomValue(state, 1.5f));
+                moistures.push_back(randomValue(state, 1.5f));
+            }
+            std::vector<float> rowHeights, rowMoistures;
+            for(float height : heights)
+                for(unsigned m = 0; m < moistures.size(); m += heights.size() > 1000 ? 97 : 1)
+                {
+                    rowHeights.push_back(height);
+                    rowMoistures.push_back(moistures[m]);
+                }
+            std::vector<World::BIOME> classified(rowHeights.size());
+            table.classify(rowHeights.data(), rowMoistures.data(), classified.data(),
+                           classified.size());
+            for(size_t i = 0; i < classified.size(); ++i)
+                if(classified[i] != oldBiome(rowHeights[i], rowMoistures[i]))
+                {
+                    std::ostringstream error;
+                    error.precision(9);
+                    error << "height " << rowHeights[i] << " moisture " << rowMoistures[i];
+                    return error.str();
+                }
+            BiomeTable rules;
+            if(rules.parse("height from -1 river\n"))
+                return "river is accepted";
+            return "";
+        });
+    }
+
+    // a compiled TerrainGraph gives the heights and moistures of
+    // evaluating the graph node by node, with and without cached fields
+    // and on previews
+    void terrain()
+    {
+        run("terrain_program_matches_graph", []() -> std::string
+        {
+            const unsigned width = 300, height = 77;
+            PerlinNoise2D noise(5, 1234);
+            for(unsigned variant = 0; variant < 3; ++variant)
+            {
+                TerrainGraph graph;
+                unsigned warpX = graph.noise(211, 0, 0.0625f), warpY = graph.noise(0, 211, 0.0625f);
+                unsigned warped = graph.warpedNoise(0, 0, 0.125f, warpX, warpY,
+                                                    variant == 0 ? 0.0f : 17.0f);
+                // a node no output depends on
+                graph.add(graph.noise(5, 5, 3.0f), graph.constant(2.0f));
+                unsigned constant = graph.add(graph.constant(0.25f), graph.remap(graph.constant(0.7f)));
+                unsigned curve = graph.curve(graph.remap(warped), {-1.0f, -1.0f, 0.0f, -0.2f,
+                                                                   0.3f, 0.5f, 1.0f, 0.9f});
+                unsigned elevation = graph.subtract(graph.add(curve, constant),
+                                                    graph.multiply(graph.constant(0.6f),
+                                                                   graph.falloff(2.0f)));
+                elevation = graph.minimum(graph.maximum(elevation, graph.constant(-1.0f)),
+                                          graph.multiply(elevation, elevation));
+                unsigned moisture = graph.add(graph.remap(graph.noise(53, 71, 0.0625f)),
+                                              graph.falloff(2.0f));
+                // a constant height and the falloff twice as moisture
+                if(variant == 2)
+                    graph.setOutputs(constant, graph.falloff(2.0f));
+                else
+                    graph.setOutputs(elevation, moisture);
+                for(unsigned step : {1u, 3u})
+                    for(bool cacheFields : {true, false})
+                    {
+                        World world(width, height, step);
+                        world.noise = &noise;
+                        world.cacheFields = cacheFields;
+                        world.terrain = &graph;
+                        world.generate(false);
+                        // the second generation reads the cached fields
+                        world.generate(false);
+                        for(unsigned y = 0; y < world.getHeight(); ++y)
+                            for(unsigned x = 0; x < world.getWidth(); ++x)
+                            {
+                                float expected = evaluate(graph, graph.getHeight(), noise,
+                                                          (long) x * step, (long) y * step,
+                                                          width, height);
+                                float expectedMoisture = evaluate(graph, graph.getMoisture(), noise,
+                                                                  (long) x * step, (long) y * step,
+                                                                  width, height);
+                                // the moisture shows in the biome; coast stays
+                                // ocean without adjust, rivers cover the rest
+                                World::BIOME biome = oldBiome(expected, expectedMoisture);
+                                if(biome == World::COAST)
+                                    biome = World::OCEAN;
+                                if(!same(&expected, &world.getHeightmap()[y][x], 1) ||
+                                   (world.tiles[y][x] != World::RIVER && world.tiles[y][x] != biome))
+                                    return "variant " + std::to_string(variant) + " step " +
+                                           std::to_string(step) + " at " + std::to_string(x) +
+                                           "," + std::to_string(y);
+                            }
+                    }
+            }
+            // graphs that cannot be evaluated are rejected
+            TerrainGraph empty;
+            World world(4, 4);
+            world.noise = &noise;
+            world.terrain = &empty;
+            try
+            {
+                world.generate(false);
+                return "a graph without outputs generates";
+            }
+            catch(const std::invalid_argument &) {}
+            try
+            {
+                empty.remap(3);
+                return "a node with a missing input is added";
+            }
+            catch(const std::invalid_argument &) {}
+            return "";
+        });
+    }
+
+    // adjustBiomes() assigns the biomes of the old flood fill
+    void regions()
+    {
+        run("adjust_biomes_matches_flood_fill", []() -> std::string
+        {
+            for(unsigned long seed : {1ul, 42ul, 3977ul, 17811ul, 123456ul})
+            {
+                PerlinNoise2D noise(5, seed);
+                World labelled(300, 200), filled(300, 200);
+                labelled.noise = filled.noise = &noise;
+                labelled.generateTerrain();
+                filled.generateTerrain();
+                labelled.adjustBiomes();
+                for(unsigned b = World::OCEAN; b <= World::SNOW; ++b)
+                    floodFillBiome(filled, b, false);
+                filled.restoreCoast();
+                floodFillBiome(filled, World::COAST, false);
+                floodFillBiome(filled, World::OCEAN, true);
+                if(!same(labelled.tiles.data(), filled.tiles.data(), 300 * 200))
+                    return "seed " + std::to_string(seed);
+            }
+            return "";
+        });
+    }
+
+    // RiverRouter finds the tiles and paths of a plain priority queue
+    // search, which expands the open tile of the lowest height bucket and
+    // the last opened of a bucket first
+    void rivers()
+    {
+        run("river_router_matches_priority_queue", []() -> std::string
+        {
+            const unsigned width = 200, height = 150;
+            const float level = 0.0f;
+            const uint32_t NONE = ~(uint32_t) 0;
+            // the bucket of RiverRouter
+            auto bucket = [](float h) -> unsigned
+            {
+                float key = (h - -1.0f) * (16384 / (2.0f - -1.0f));
+                if(!(key > 0.0f))
+                    return 0;
+                if(key >= 16384 - 1)
+                    return 16384 - 1;
+                return (unsigned) key;
+            };
+            // bucket, inverted opening order and tile, the smallest on top
+            typedef std::tuple<unsigned, unsigned long, uint32_t> Open;
+            RiverRouter router(width, height);
+            std::vector<uint32_t> parents;
+            // routes from every 13th tile above level down to water
+            auto compare = [&](const std::vector<float> &heights) -> std::string
+            {
+                unsigned routed = 0;
+                for(uint32_t source = 0; source < heights.size(); source += 13)
+                {
+                    if(heights[source] < level)
+                        continue;
+                    uint32_t found = router.search(heights.data(), source, [&](uint32_t index)
+                    {
+                        return heights[index] < level;
+                    });
+                    std::priority_queue<Open, std::vector<Open>, std::greater<Open>> queue;
+                    unsigned long order = 0;
+                    parents.assign(heights.size(), NONE);
+                    parents[source] = source;
+                    queue.push(Open(bucket(heights[source]), ~order++, source));
+                    uint32_t expected = RiverRouter::NO_TARGET;
+                    while(!queue.empty())
+                    {
+                        uint32_t index = std::get<2>(queue.top());
+                        if(heights[index] < level)
+                        {
+                            expected = index;
+                            break;
+                        }
+                        queue.pop();
+                        unsigned x = index % width, y = index / width;
+                        const bool inside[4] = {y > 0, y < height - 1, x > 0, x < width - 1};
+                        const uint32_t next[4] = {index - width, index + width, index - 1, index + 1};
+                        for(unsigned n = 0; n < 4; ++n)
+                            if(inside[n] && parents[next[n]] == NONE)
+                            {
+                                parents[next[n]] = index;
+                                queue.push(Open(bucket(heights[next[n]]), ~order++, next[n]));
+                            }
+                    }
+                    std::string where = "from tile " + std::to_string(source);
+                    if(found != expected)
+                        return "target " + where;
+                    if(found == RiverRouter::NO_TARGET)
+                        continue;
+                    ++routed;
+                    for(uint32_t index = found, length = 0; index != source; ++length)
+                    {
+                        uint32_t parent = router.parent(index);
+                        if(parent != parents[index] || length > heights.size())
+                            return "path " + where;
+                        index = parent;
+                    }
+                }
+                if(routed < 100)
+                    return "only " + std::to_string(routed) + " rivers reach water";
+                return "";
+            };
+            World world(width, height);
+            PerlinNoise2D noise(5, 3);
+            world.noise = &noise;
+            world.generate(false);
+            const float *heightmap = world.getHeightmap().data();
+            std::vector<float> heights(heightmap, heightmap + (size_t) width * height);
+            std::string error = compare(heights);
+            if(!error.empty())
+                return error;
+            // in steps of 1/64 many tiles share a bucket, so the order in
+            // which a bucket is expanded counts
+            for(float &h : heights)
+                h = floorf(h * 64.0f) / 64.0f;
+            return compare(heights);
+        });
+    }
+
+    // river source candidates are at least their spacing apart, inside
+    // the world, and the same for the same seed
+    void sources()
+    {
+        run("poisson_disk_keeps_spacing", []() -> std::string
+        {
+            PoissonDisk sampler, again;
+            const float sizes[][2] = {{600.0f, 600.0f}, {1000.0f, 250.0f}, {37.0f, 90.0f}};
+            for(auto size : sizes)
+                for(float spacing : {16.0f, 7.5f, 40.0f})
+                    for(uint64_t seed : {1ull, 27728ull, 987654321ull})
+                    {
+                        const std::vector<PoissonDisk::Point> &points =
+                            sampler.sample(size[0], size[1], spacing, seed);
+                        std::ostringstream where;
+                        where << size[0] << "x" << size[1] << " spacing " << spacing << " seed " << seed;
+                        // a sample that stopped early has far fewer points
+                        float area = size[0] * size[1], disk = 3.1415927f * spacing * spacing;
+                        if(points.size() < area / (4.0f * disk))
+                            return "too few points, " + where.str();
+                        const std::vector<PoissonDisk::Point> &repeated =
+                            again.sample(size[0], size[1], spacing, seed);
+                        if(repeated.size() != points.size() ||
+                           !same(repeated.data(), points.data(), points.size()))
+                            return "different points for the same seed, " + where.str();
+                        for(size_t i = 0; i < points.size(); ++i)
+                        {
+                            if(!(points[i].x >= 0.0f && points[i].x < size[0] &&
+                                 points[i].y >= 0.0f && points[i].y < size[1]))
+                                return "point outside, " + where.str();
+                            for(size_t j = 0; j < i; ++j)
+                            {
+                                float dx = points[i].x - points[j].x, dy = points[i].y - points[j].y;
+                                if(dx * dx + dy * dy < spacing * spacing)
+                                    return "points " + std::to_string(j) + " and " +
+                                           std::to_string(i) + " too close, " + where.str();
+                            }
+                        }
+                    }
+            return "";
+        });
+    }
+
+    // distances and region queries of a generated world against brute force
+    void maps()
+    {
+        World world(128, 96);
+        PerlinNoise2D noise(5, 77);
+        world.noise = &noise;
+        world.generate(true);
+        unsigned width = world.getWidth(), height = world.getHeight();
+        run("distance_map_matches_brute_force", [&]() -> std::string
+        {
+            ThreadPool pool(3);
+            DistanceMap single, threaded;
+            single.build(world);
+            threaded.build(world, &pool);
+            const unsigned targets[DistanceMap::FIELD_COUNT] = {
+                1u << World::OCEAN | 1u << World::COAST | 1u << World::LAKE | 1u << World::RIVER,
+                1u << World::OCEAN, 1u << World::COAST, 1u << World::LAKE, 1u << World::RIVER
+            };
+            for(unsigned f = 0; f < DistanceMap::FIELD_COUNT; ++f)
+            {
+                DistanceMap::FIELD field = (DistanceMap::FIELD) f;
+                std::vector<unsigned> xs, ys;
+                for(unsigned y = 0; y < height; ++y)
+                    for(unsigned x = 0; x < width; ++x)
+                        if(targets[f] >> world.tiles[y][x] & 1)
+                        {
+                            xs.push_back(x);
+                            ys.push_back(y);
+                        }
+                for(unsigned y = 0; y < height; ++y)
+                    for(unsigned x = 0; x < width; ++x)
+                    {
+                        unsigned long best = ~0ul;
+                        for(size_t i = 0; i < xs.size(); ++i)
+                        {
+                            long dx = (long) xs[i] - x, dy = (long) ys[i] - y;
+                            best = std::min(best, (unsigned long) (dx * dx + dy * dy));
+                        }
+                        float expected = xs.empty() ? INFINITY : sqrtf((float) best);
+                        float found = single.getDistance(field, x, y);
+                        float other = threaded.getDistance(field, x, y);
+                        if(!same(&found, &expected, 1) || !same(&other, &expected, 1))
+                            return "field " + std::to_string(f) + " at " + std::to_string(x) +
+                                   "," + std::to_string(y);
+                    }
+            }
+            return "";
+        });
+        run("region_map_matches_brute_force", [&]() -> std::string
+        {
+            RegionMap map;
+            map.build(world);
+            // regions by flood fill
+            std::vector<unsigned> labels((size_t) width * height, RegionMap::NO_REGION);
+            std::vector<size_t> stack;
+            unsigned count = 0;
+            for(size_t start = 0; start < labels.size(); ++start)
+            {
+                if(labels[start] != RegionMap::NO_REGION)
+                    continue;
+                World::BIOME biome = world.tiles.data()[start];
+                unsigned long area = 0;
+                unsigned id = map.getRegionAt(start % width, start / width);
+                unsigned minX = width, minY = height, maxX = 0, maxY = 0;
+                labels[start] = count;
+                stack.push_back(start);
+                while(!stack.empty())
+                {
+                    size_t index = stack.back();
+                    stack.pop_back();
+                    unsigned x = index % width, y = index / width;
+                    if(map.getRegionAt(x, y) != id)
+                        return "tiles of one region have different ids";
+                    ++area;
+                    minX = std::min(minX, x);
+                    minY = std::min(minY, y);
+                    maxX = std::max(maxX, x);
+                    maxY = std::max(maxY, y);
+                    size_t next[4] = {index - 1, index + 1, index - width, index + width};
+                    bool inside[4] = {x > 0, x + 1 < width, y > 0, y + 1 < height};
+                    for(unsigned n = 0; n < 4; ++n)
+                        if(inside[n] && labels[next[n]] == RegionMap::NO_REGION &&
+                           world.tiles.data()[next[n]] == biome)
+                        {
+                            labels[next[n]] = count;
+                            stack.push_back(next[n]);
+                        }
+                }
+                const RegionMap::Region &region = map.getRegion(id);
+                if(region.biome != biome || region.area != area || region.minX != minX ||
+                   region.minY != minY || region.maxX != maxX || region.maxY != maxY ||
+                   region.touchesEdge != (minX == 0 || minY == 0 || maxX == width - 1 ||
+                                          maxY == height - 1))
+                    return "region " + std::to_string(id) + " has other properties";
+                ++count;
+            }
+            if(count != map.getRegionCount())
+                return "region count";
+            for(unsigned b = 0; b <= World::RIVER; ++b)
+            {
+                World::BIOME biome = (World::BIOME) b;
+                for(unsigned y = 0; y < height; y += 5)
+                    for(unsigned x = 0; x < width; x += 7)
+                    {
+                        unsigned long best = ~0ul;
+                        for(unsigned ty = 0; ty < height; ++ty)
+                            for(unsigned tx = 0; tx < width; ++tx)
+                                if(world.tiles[ty][tx] == biome)
+                                {
+                                    long dx = (long) tx - x, dy = (long) ty - y;
+                                    best = std::min(best, (unsigned long) (dx * dx + dy * dy));
+                                }
+                        unsigned foundX = 0, foundY = 0;
+                        bool found = map.findNearest(biome, x, y, foundX, foundY);
+                        long dx = (long) foundX - x, dy = (long) foundY - y;
+                        if(found != (best != ~0ul) ||
+                           (found && (world.tiles[foundY][foundX] != biome ||
+                                      (unsigned long) (dx * dx + dy * dy) != best)))
+                            return "nearest " + std::string(World::BIOME_NAMES[b]) + " to " +
+                                   std::to_string(x) + "," + std::to_string(y);
+                    }
+                uint64_t state = b + 1;
+                std::vector<unsigned> found;
+                for(unsigned i = 0; i < 200; ++i)
+                {
+                    unsigned x0 = nextRandom(state) % width, y0 = nextRandom(state) % height;
+                    unsigned x1 = x0 + nextRandom(state) % 80, y1 = y0 + nextRandom(state) % 60;
+                    std::vector<unsigned> expected;
+                    for(unsigned y = y0; y < std::min(y1, height); ++y)
+                        for(unsigned x = x0; x < std::min(x1, width); ++x)
+                            if(world.tiles[y][x] == biome)
+                                expected.push_back(map.getRegionAt(x, y));
+                    std::sort(expected.begin(), expected.end());
+                    expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+                    map.findRegions(biome, x0, y0, x1, y1, found);
+                    if(found != expected)
+                        return "regions of " + std::string(World::BIOME_NAMES[b]) + " in a rectangle";
+                }
+            }
+            return "";
+        });
+    }
+
+    // world files with sections beyond their end do not open, and tiles
+    // that are not biomes read as rivers
+    void files()
+    {
+        run("world_file_rejects_corruption", []() -> std::string
+        {
+            const char *path = "perlin-check.world";
+            World world(101, 64);
+            PerlinNoise2D noise(4, 5);
+            world.noise = &noise;
+            world.generate(true);
+            if(!saveWorld(world, true, path))
+                return "cannot write " + std::string(path);
+            std::vector<char> bytes;
+            {
+                std::ifstream file(path, std::ios::binary);
+                bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            }
+            // writes bytes changed by corrupt and opens them as file
+            auto opens = [&](void (*corrupt)(std::vector<char> &bytes), WorldFile &file) -> bool
+            {
+                std::vector<char> copy = bytes;
+                if(corrupt)
+                    corrupt(copy);
+                std::ofstream(path, std::ios::binary).write(copy.data(), copy.size());
+                return file.open(path);
+            };
+            struct Corruption
+            {
+                const char *name;
+                void (*corrupt)(std::vector<char> &bytes);
+            };
+            const Corruption corruptions[] = {
+                {"height offset past the end", [](std::vector<char> &bytes)
+                {
+                    uint64_t offset = ~(uint64_t) 0 - 255;
+                    memcpy(&bytes[offsetof(WorldFileHeader, heightOffset)], &offset, 8);
+                }},
+                {"tile offset past the end", [](std::vector<char> &bytes)
+                {
+                    uint64_t offset = ~(uint64_t) 0 - 16;
+                    memcpy(&bytes[offsetof(WorldFileHeader, tileOffset)], &offset, 8);
+                }},
+                {"tile stride too short", [](std::vector<char> &bytes)
+                {
+                    uint32_t stride = 50;
+                    memcpy(&bytes[offsetof(WorldFileHeader, tileStride)], &stride, 4);
+                }},
+                {"tile stride too long", [](std::vector<char> &bytes)
+                {
+                    uint32_t stride = 0x80000000u;
+                    memcpy(&bytes[offsetof(WorldFileHeader, tileStride)], &stride, 4);
+                }}
+            };
+            std::string error;
+            WorldFile file;
+            if(!opens(nullptr, file))
+                error = "the written file does not open";
+            for(const Corruption &corruption : corruptions)
+                if(error.empty() && opens(corruption.corrupt, file))
+                    error = std::string(corruption.name) + " opens";
+            // tile (63, 63) becomes 15, past the last biome
+            auto badTile = [](std::vector<char> &bytes)
+            {
+                WorldFileHeader header;
+                memcpy(&header, bytes.data(), sizeof(header));
+                bytes[header.tileOffset + 63 * header.tileStride + 31] |= 0xf0;
+            };
+            if(error.empty() && !opens(badTile, file))
+                error = "a file with a bad tile does not open";
+            std::vector<World::BIOME> row(world.getWidth());
+            for(unsigned y = 0; error.empty() && y < world.getHeight(); ++y)
+            {
+                file.getTiles(y, row.data());
+                for(unsigned x = 0; x < world.getWidth(); ++x)
+                {
+                    World::BIOME expected = x == 63 && y == 63 ? World::RIVER : world.tiles[y][x];
+                    if(row[x] != expected || file.getTile(x, y) != expected)
+                    {
+                        error = "tile " + std::to_string(x) + "," + std::to_string(y) +
+                                " reads as " + std::to_string(row[x]);
+                        break;
+                    }
+                }
+            }
+            file.close();
+            remove(path);
+            return error;
+        });
+    }
+};
+
+int main(int argc, char **argv)
+{
+    std::string filter;
+    if(argc == 3 && std::string(argv[1]) == "--filter")
+        filter = argv[2];
+    else if(argc != 1)
+    {
+        std::cerr << "usage: perlin-check [--filter TEXT]\n";
+        return 1;
+    }
+    Checks checks(filter);
+    checks.noise();
+    checks.threads();
+    checks.incremental();
+    checks.biomes();
+    checks.terrain();
+    checks.regions();
+    checks.rivers();
+    checks.sources();
+    checks.maps();
+    checks.files();
+    if(checks.getFailed())
+    {
+        std::cout << checks.getFailed() << " checks failed\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,461 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <chrono>
+#include <stdlib.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+#include "World.h"
+#include "ChunkedWorld.h"
+#include "WorldFile.h"
+#include "SeedSweep.h"
+#include "RegionMap.h"
+#include "DistanceMap.h"
+#include "BiomeTable.h"
+
+struct Options
+{
+    unsigned long seed;
+    unsigned count = 1;
+    unsigned octaves = 5;
+    PerlinNoise2D::HASH hash = PerlinNoise2D::POLYNOMIAL;
+    unsigned width = 600, height = 600;
+    unsigned step = 1;
+    unsigned threads = std::thread::hardware_concurrency();
+    float a = 0.1f, b = 0.55f, c = 1.4f;
+    float warp = 0.0f;
+    bool adjust = true;
+    bool erode = false;
+    unsigned maxRivers = 5;
+    std::string biomes;
+    bool stats = false;
+    bool regions = false;
+    bool distances = false;
+    std::string out = "world";
+    unsigned bench = 0;
+    bool chunk = false;
+    int64_t chunkX = 0, chunkY = 0;
+    bool save = false;
+    std::string load;
+    bool sweep = false;
+};
+
+void usage()
+{
+    std::cerr <<
+        "usage: perlin-gen [options]\n"
+        "  --seed N       first seed (default: random)\n"
+        "  --count N      generate N consecutive seeds (default: 1)\n"
+        "  --octaves N    noise octaves, 1 to 7 (default: 5)\n"
+        "  --hash NAME    noise hash, polynomial or permutation (default: polynomial)\n"
+        "  --a X          falloff offset (default: 0.1)\n"
+        "  --b X          falloff strength (default: 0.55)\n"
+        "  --c X          falloff exponent (default: 1.4)\n"
+        "  --warp X       tiles the height noise is warped by (default: 0)\n"
+        "  --size WxH     world size (default: 600x600)\n"
+        "  --step N       write a preview at 1/N of the resolution (default: 1)\n"
+        "  --chunk X,Y    write chunk X,Y of the unbounded world instead; its\n"
+        "                 size is the width of --size\n"
+        "  --no-adjust    keep small biome regions\n"
+        "  --rivers N     rivers of a world with little water (default: 5)\n"
+        "  --erode        erode the terrain before assigning biomes\n"
+        "  --biomes FILE  biome rules by height and moisture (default: built in)\n"
+        "  --save         also write PREFIX-SEED.world, a binary world file\n"
+        "  --load FILE    write the images of a saved world instead\n"
+        "  --sweep        print statistics of every seed instead of writing images\n"
+        "  --stats        print stage timings and counters of every world\n"
+        "  --regions      print the regions and landmasses of every world\n"
+        "  --distances    print the coastlines and distances to water of every world\n"
+        "  --threads N    worker threads (default: all cores)\n"
+        "  --out PREFIX   output prefix (default: world)\n"
+        "  --bench [MAX]  time square worlds from 512 up to MAX (default: 16384)\n"
+        "writes PREFIX-SEED.ppm (biomes) and PREFIX-SEED-height.pgm (16 bit),\n"
+        "chunks go to PREFIX-SEED-chunkX_Y.ppm and PREFIX-SEED-chunkX_Y-height.pgm\n";
+}
+
+bool parse(int argc, char **argv, Options &options)
+{
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if(arg == "--no-adjust")
+            options.adjust = false;
+        else if(arg == "--erode")
+            options.erode = true;
+        else if(arg == "--stats")
+            options.stats = true;
+        else if(arg == "--regions")
+            options.regions = true;
+        else if(arg == "--distances")
+            options.distances = true;
+        else if(arg == "--save")
+            options.save = true;
+        else if(arg == "--sweep")
+            options.sweep = true;
+        else if(arg == "--bench")
+        {
+            options.bench = 16384;
+            if(hasValue && argv[i + 1][0] != '-')
+                options.bench = atoi(argv[++i]);
+        }
+        else if(!hasValue)
+            return false;
+        else if(arg == "--seed")
+            options.seed = strtoul(argv[++i], nullptr, 10);
+        else if(arg == "--count")
+            options.count = atoi(argv[++i]);
+        else if(arg == "--octaves")
+            options.octaves = atoi(argv[++i]);
+        else if(arg == "--hash")
+        {
+            std::string name = argv[++i];
+            if(name == "polynomial")
+                options.hash = PerlinNoise2D::POLYNOMIAL;
+            else if(name == "permutation")
+                options.hash = PerlinNoise2D::PERMUTATION;
+            else
+                return false;
+        }
+        else if(arg == "--a")
+            options.a = atof(argv[++i]);
+        else if(arg == "--b")
+            options.b = atof(argv[++i]);
+        else if(arg == "--c")
+            options.c = atof(argv[++i]);
+        else if(arg == "--warp")
+            options.warp = atof(argv[++i]);
+        else if(arg == "--rivers")
+            options.maxRivers = atoi(argv[++i]);
+        else if(arg == "--biomes")
+            options.biomes = argv[++i];
+        else if(arg == "--step")
+            options.step = atoi(argv[++i]);
+        else if(arg == "--threads")
+            options.threads = atoi(argv[++i]);
+        else if(arg == "--out")
+            options.out = argv[++i];
+        else if(arg == "--load")
+            options.load = argv[++i];
+        else if(arg == "--size")
+        {
+            char *end;
+            options.width = strtoul(argv[++i], &end, 10);
+            options.height = *end == 'x' ? strtoul(end + 1, nullptr, 10) : options.width;
+        }
+        else if(arg == "--chunk")
+        {
+            char *end;
+            options.chunk = true;
+            options.chunkX = strtoll(argv[++i], &end, 10);
+            if(*end != ',')
+                return false;
+            options.chunkY = strtoll(end + 1, nullptr, 10);
+        }
+        else
+            return false;
+    }
+    return options.count > 0 && options.width > 0 && options.height > 0 && options.step > 0 &&
+           options.octaves >= 1 && options.octaves <= PerlinNoise2D::MAX_OCTAVES;
+}
+
+// binary ppm with the viewer colours
+bool writeBiomes(const Grid<World::BIOME> &tiles, const std::string &path)
+{
+    std::ofstream file(path.c_str(), std::ios::binary);
+    file << "P6\n" << tiles.getWidth() << " " << tiles.getHeight() << "\n255\n";
+    std::vector<char> row(tiles.getWidth() * 3);
+    for(unsigned y = 0; y < tiles.getHeight(); ++y)
+    {
+        for(unsigned x = 0; x < tiles.getWidth(); ++x)
+            for(unsigned i = 0; i < 3; ++i)
+                row[x * 3 + i] = World::COLORS[tiles[y][x]][i];
+        file.write(row.data(), row.size());
+    }
+    return file.good();
+}
+
+// 16 bit big endian pgm, heights from -1 to 1 mapped to the full range
+bool writeHeightmap(const Grid<float> &heightmap, const std::string &path)
+{
+    std::ofstream file(path.c_str(), std::ios::binary);
+    file << "P5\n" << heightmap.getWidth() << " " << heightmap.getHeight() << "\n65535\n";
+    std::vector<char> row(heightmap.getWidth() * 2);
+    for(unsigned y = 0; y < heightmap.getHeight(); ++y)
+    {
+        for(unsigned x = 0; x < heightmap.getWidth(); ++x)
+        {
+            float height = std::min(std::max(heightmap[y][x], -1.0f), 1.0f);
+            unsigned value = (unsigned) ((height + 1.0f) * 32767.5f);
+            row[x * 2] = value >> 8;
+            row[x * 2 + 1] = value & 0xff;
+        }
+        file.write(row.data(), row.size());
+    }
+    return file.good();
+}
+
+// writes the images of the world file options.load
+int writeSaved(const Options &options)
+{
+    WorldFile file;
+    if(!file.open(options.load))
+    {
+        std::cerr << "cannot read " << options.load << "\n";
+        return 1;
+    }
+    const WorldFileHeader &header = file.getHeader();
+    std::cout << header.width << "x" << header.height << ", seed " << header.seed << ", " <<
+                 header.octaves << " octaves, " <<
+                 (header.hash == PerlinNoise2D::PERMUTATION ? "permutation" : "polynomial") <<
+                 " hash, a = " << header.a << " b = " << header.b << " c = " << header.c <<
+                 (header.adjust ? "" : ", not adjusted") << ", " << header.riverCount <<
+                 " rivers\n";
+    Grid<World::BIOME> tiles(header.width, header.height);
+    Grid<float> heightmap(header.width, header.height);
+    for(unsigned y = 0; y < header.height; ++y)
+    {
+        file.getTiles(y, tiles[y]);
+        std::copy(file.getHeights(y), file.getHeights(y) + header.width, heightmap[y]);
+    }
+    std::string prefix = options.out + "-" + std::to_string(header.seed);
+    if(!writeBiomes(tiles, prefix + ".ppm") ||
+       !writeHeightmap(heightmap, prefix + "-height.pgm"))
+    {
+        std::cerr << "failed to write " << prefix << "\n";
+        return 1;
+    }
+    std::cout << prefix << ".ppm\n";
+    return 0;
+}
+
+// region count, landmasses and the largest region of every biome
+void printRegions(const RegionMap &map, std::ostream &out)
+{
+    out << "regions: " << map.getRegionCount() << ", landmasses: " << map.getLandmassCount();
+    if(map.getLargestLandmass() != RegionMap::NO_REGION)
+        out << ", largest " << map.getLandmassArea(map.getLargestLandmass()) << " tiles";
+    out << "\n";
+    for(unsigned b = 0; b <= World::RIVER; ++b)
+    {
+        unsigned id = map.getLargest((World::BIOME) b);
+        if(id == RegionMap::NO_REGION)
+            continue;
+        const RegionMap::Region &region = map.getRegion(id);
+        out << "largest " << World::BIOME_NAMES[b] << ": " << region.area << " tiles in (" <<
+               region.minX << ", " << region.minY << ") to (" << region.maxX << ", " <<
+               region.maxY << "), " << map.getNeighbourCount(id) << " neighbours\n";
+    }
+}
+
+// coastline counts and the tile farthest from any water
+void printDistances(const DistanceMap &map, std::ostream &out)
+{
+    unsigned long closed = 0, points = 0;
+    for(unsigned i = 0; i < map.getCoastlineCount(); ++i)
+    {
+        closed += map.getCoastline(i).closed;
+        points += map.getCoastline(i).count;
+    }
+    out << "coastlines: " << map.getCoastlineCount() << " (" << closed << " closed), " <<
+           points << " points\n";
+    if(!map.hasField(DistanceMap::WATER))
+        return;
+    const Grid<float> &water = map.getField(DistanceMap::WATER);
+    unsigned farX = 0, farY = 0;
+    for(unsigned y = 0; y < water.getHeight(); ++y)
+        for(unsigned x = 0; x < water.getWidth(); ++x)
+            if(water[y][x] > water[farY][farX])
+            {
+                farX = x;
+                farY = y;
+            }
+    out << "farthest from water: " << water[farY][farX] << " tiles at (" << farX << ", " <<
+           farY << ")\n";
+}
+
+// generates the --count seeds without keeping them and prints one line of
+// statistics per seed
+void sweep(const Options &options, const BiomeTable &biomes, ThreadPool &pool)
+{
+    WorldSettings settings;
+    settings.hash = options.hash;
+    settings.octaves = options.octaves;
+    settings.a = options.a;
+    settings.b = options.b;
+    settings.c = options.c;
+    settings.warp = options.warp;
+    settings.adjust = options.adjust;
+    settings.erode = options.erode;
+    settings.maxRivers = options.maxRivers;
+    settings.biomes = &biomes;
+    SeedSweep sweep(options.width, options.height, &pool);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<SweepResult> results = sweep.run(options.seed, options.count, settings);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "seed\twater\trivers\tlakes";
+    for(unsigned b = 0; b <= World::RIVER; ++b)
+        std::cout << "\t" << World::BIOME_NAMES[b];
+    std::cout << "\n";
+    for(auto &result : results)
+    {
+        std::cout << result.seed << "\t" << result.waterFactor << "\t" <<
+                     result.riverCount << "\t" << result.lakeCount;
+        for(auto count : result.histogram)
+            std::cout << "\t" << count;
+        std::cout << "\n";
+    }
+    std::cerr << options.count << " worlds in " << elapsed.count() << " s, " <<
+                 options.count / elapsed.count() << " worlds/s\n";
+}
+
+// peak resident set size of the process in kilobytes
+unsigned long peakMemory()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if(GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize / 1024;
+    return 0;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+// generates square worlds of growing size with a fixed seed; sizes go up,
+// so the process peak after each run is the peak of that size
+void benchmark(const Options &options, ThreadPool &pool)
+{
+    PerlinNoise2D noise(options.octaves, 1234, options.hash);
+    std::cout << "size\tseconds\tpeak MB\n";
+    for(unsigned size = 512; size <= options.bench; size *= 2)
+    {
+        World world(size, size);
+        world.noise = &noise;
+        world.pool = &pool;
+        // one generation per size, the caches would only cost memory
+        world.cacheFields = false;
+        auto start = std::chrono::steady_clock::now();
+        world.generate(options.adjust);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << size << "\t" << elapsed.count() << "\t" <<
+                     peakMemory() / 1024 << "\n";
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    srand(time(NULL));
+    options.seed = rand();
+    if(!parse(argc, argv, options))
+    {
+        usage();
+        return 1;
+    }
+    ThreadPool pool(options.threads);
+    if(options.bench)
+    {
+        benchmark(options, pool);
+        return 0;
+    }
+    if(!options.load.empty())
+        return writeSaved(options);
+    BiomeTable biomes;
+    if(!options.biomes.empty() && !biomes.load(options.biomes))
+    {
+        std::cerr << "cannot read biome rules from " << options.biomes << "\n";
+        return 1;
+    }
+    if(options.sweep)
+    {
+        sweep(options, biomes, pool);
+        return 0;
+    }
+    if(options.chunk)
+    {
+        for(unsigned i = 0; i < options.count; ++i)
+        {
+            unsigned long seed = options.seed + i;
+            PerlinNoise2D noise(options.octaves, seed, options.hash);
+            ChunkedWorld chunks(&noise, options.width);
+            chunks.pool = &pool;
+            chunks.a = options.a;
+            chunks.biomes = &biomes;
+            auto chunk = chunks.getChunk(options.chunkX, options.chunkY);
+            std::string prefix = options.out + "-" + std::to_string(seed) + "-chunk" +
+                                 std::to_string(options.chunkX) + "_" +
+                                 std::to_string(options.chunkY);
+            if(!writeBiomes(chunk->tiles, prefix + ".ppm") ||
+               !writeHeightmap(chunk->heightmap, prefix + "-height.pgm"))
+            {
+                std::cerr << "failed to write " << prefix << "\n";
+                return 1;
+            }
+            std::cout << "seed " << seed << ": " << prefix << ".ppm\n";
+        }
+        return 0;
+    }
+    // one world is reused for the whole batch
+    World world(options.width, options.height, options.step);
+    GenerationStats stats;
+    Erosion erosion;
+    RegionMap regionMap;
+    DistanceMap distanceMap;
+    world.pool = &pool;
+    // every world of the batch has a new seed, the caches would only cost
+    // memory
+    world.cacheFields = false;
+    if(options.erode)
+        world.erosion = &erosion;
+    if(options.regions)
+        world.regionMap = &regionMap;
+    if(options.distances)
+        world.distanceMap = &distanceMap;
+    if(options.stats)
+        world.stats = &stats;
+    world.a = options.a;
+    world.b = options.b;
+    world.c = options.c;
+    world.warp = options.warp;
+    world.maxRivers = options.maxRivers;
+    world.biomes = &biomes;
+    for(unsigned i = 0; i < options.count; ++i)
+    {
+        unsigned long seed = options.seed + i;
+        PerlinNoise2D noise(options.octaves, seed, options.hash);
+        world.noise = &noise;
+        world.generate(options.adjust);
+        std::string prefix = options.out + "-" + std::to_string(seed);
+        if(!writeBiomes(world.tiles, prefix + ".ppm") ||
+           !writeHeightmap(world.getHeightmap(), prefix + "-height.pgm"))
+        {
+            std::cerr << "failed to write " << prefix << "\n";
+            return 1;
+        }
+        if(options.save && !saveWorld(world, options.adjust, prefix + ".world"))
+        {
+            std::cerr << "failed to write " << prefix << ".world\n";
+            return 1;
+        }
+        std::cout << "seed " << seed << ": " << prefix << ".ppm\n";
+        if(options.stats)
+            stats.print(std::cout);
+        if(options.regions)
+            printRegions(regionMap, std::cout);
+        if(options.distances)
+            printDistances(distanceMap, std::cout);
+    }
+    return 0;
+}